@@ -0,0 +1,52 @@
+#include "arena.h"
+#include <algorithm>
+#include <cstdint>
+
+Arena::Arena(size_t block_size) : block_size_(std::max<size_t>(block_size, 64)) {}
+
+void* Arena::allocate(size_t bytes, size_t alignment) {
+    // Bump through the existing blocks first; after a reset they are
+    // reused in order
+    for (; current_ < blocks_.size(); current_++, offset_ = 0) {
+        Block& block = blocks_[current_];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        uintptr_t aligned = (base + offset_ + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        size_t end = static_cast<size_t>(aligned - base) + bytes;
+        if (end <= block.size) {
+            offset_ = end;
+            return reinterpret_cast<void*>(aligned);
+        }
+    }
+
+    // Nothing left fits: add a block, oversized for large requests
+    size_t size = std::max(block_size_, bytes + alignment);
+    blocks_.push_back({std::unique_ptr<char[]>(new char[size]), size});
+    offset_ = 0;
+    return allocate(bytes, alignment);
+}
+
+void Arena::reset() {
+    current_ = 0;
+    offset_ = 0;
+}
+
+size_t Arena::used() const {
+    size_t total = offset_;
+    for (size_t i = 0; i < current_ && i < blocks_.size(); i++) {
+        total += blocks_[i].size;
+    }
+    return total;
+}
+
+size_t Arena::capacity() const {
+    size_t total = 0;
+    for (const Block& block : blocks_) {
+        total += block.size;
+    }
+    return total;
+}
+
+Arena& thread_arena() {
+    thread_local Arena arena;
+    return arena;
+}
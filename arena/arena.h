@@ -0,0 +1,103 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator for short-lived temporaries. Allocation advances a pointer
+// through large blocks; nothing is freed individually, and reset() makes
+// all of the memory available again at once while keeping the blocks, so
+// a steady-state workload stops calling the heap entirely. Not thread-safe:
+// each thread uses its own arena (see thread_arena()).
+class Arena {
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    explicit Arena(size_t block_size = DEFAULT_BLOCK_SIZE);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Uninitialized memory for bytes bytes at the given alignment (a power
+    // of two), valid until the next reset()
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T* allocate(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Invalidates everything allocated so far; the blocks are kept
+    void reset();
+
+    // Bytes handed out since the last reset, including alignment padding
+    size_t used() const;
+    // Bytes held in blocks
+    size_t capacity() const;
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    size_t block_size_;
+    std::vector<Block> blocks_;
+    // Block being allocated from and the offset of its first free byte
+    size_t current_ = 0;
+    size_t offset_ = 0;
+};
+
+// The calling thread's arena. Render workers reset it before every tile, so
+// a shader may allocate from it freely but nothing it allocates may outlive
+// the pixel being shaded.
+Arena& thread_arena();
+
+// Standard allocator interface over an arena, so standard containers can
+// keep their storage in one. deallocate() is a no-op; the memory comes back
+// when the arena is reset, which must not happen while a container using it
+// is still alive. A default-constructed allocator uses the heap.
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept = default;
+    explicit ArenaAllocator(Arena* arena) noexcept : arena_(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena()) {}
+
+    T* allocate(size_t count) {
+        if (arena_ != nullptr) {
+            return arena_->allocate<T>(count);
+        }
+        return std::allocator<T>().allocate(count);
+    }
+
+    void deallocate(T* p, size_t count) noexcept {
+        if (arena_ == nullptr) {
+            std::allocator<T>().deallocate(p, count);
+        }
+    }
+
+    Arena* arena() const noexcept { return arena_; }
+
+private:
+    Arena* arena_ = nullptr;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return !(a == b);
+}
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif // ARENA_H
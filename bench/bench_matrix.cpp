@@ -0,0 +1,129 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "matrix/matrix.h"
+#include "matrix/affine.h"
+
+TEST_CASE("4x4 matrix multiplication", "[benchmark][matrix]") {
+    Matrix4 A = matrixMultiply(rotation_x(0.3), scaling(2, 3, 4));
+    Matrix4 B = matrixMultiply(translation(1, 2, 3), rotation_z(1.1));
+    Matrix generic_a = A;
+    Matrix generic_b = B;
+
+    BENCHMARK("matrixMultiply (generic)") {
+        return matrixMultiply(generic_a, generic_b);
+    };
+
+    BENCHMARK("matrixMultiply (Matrix4)") {
+        return matrixMultiply(A, B);
+    };
+}
+
+TEST_CASE("4x4 inverse", "[benchmark][matrix]") {
+    Matrix4 A = matrixMultiply(matrixMultiply(translation(1, -2, 3), rotation_y(0.7)),
+                               shearing(0.1, 0.2, 0.3, 0.4, 0.5, 0.6));
+    Matrix generic = A;
+
+    BENCHMARK("inverse (generic cofactor expansion)") {
+        return inverse(generic);
+    };
+
+    BENCHMARK("inverse (Matrix4 closed form)") {
+        return inverse(A);
+    };
+
+    BENCHMARK("is_invertible + inverse (generic)") {
+        return is_invertible(generic) ? inverse(generic) : Matrix(0, 0);
+    };
+
+    BENCHMARK("inverse with determinant (Matrix4)") {
+        double det;
+        Matrix4 inv = inverse(A, det);
+        return inv(0, 0) + det;
+    };
+}
+
+TEST_CASE("4x4 determinant", "[benchmark][matrix]") {
+    Matrix4 A = matrixMultiply(rotation_x(0.3), scaling(2, 3, 4));
+    Matrix generic = A;
+
+    BENCHMARK("determinant (generic)") {
+        return determinant(generic);
+    };
+
+    BENCHMARK("determinant (Matrix4)") {
+        return determinant(A);
+    };
+}
+
+TEST_CASE("Matrix-tuple multiplication", "[benchmark][matrix]") {
+    Matrix4 A = matrixMultiply(translation(1, -2, 3), rotation_y(0.7));
+    Matrix generic = A;
+    Tuple p = point(1, 2, 3);
+
+    BENCHMARK("multiply (generic Matrix, Tuple)") {
+        return multiply(generic, p);
+    };
+
+    BENCHMARK("multiply (Matrix4, Tuple)") {
+        return multiply(A, p);
+    };
+}
+
+TEST_CASE("Single-precision matrix operations", "[benchmark][matrix]") {
+    Matrix4f A = matrixMultiply(translation<float>(1, -2, 3), rotation_y<float>(0.7f));
+    Tuplef p = point<float>(1, 2, 3);
+
+    BENCHMARK("multiply (Matrix4f, Tuplef)") {
+        return multiply(A, p);
+    };
+
+    BENCHMARK("inverse (Matrix4f closed form)") {
+        return inverse(A);
+    };
+}
+
+TEST_CASE("Affine transforms", "[benchmark][matrix]") {
+    Matrix4 A = matrixMultiply(matrixMultiply(translation(1, -2, 3), rotation_y(0.7)),
+                               shearing(0.1, 0.2, 0.3, 0.4, 0.5, 0.6));
+    Matrix4 B = matrixMultiply(rotation_x(0.3), scaling(2, 3, 4));
+    Affine3 affine_a(A);
+    Affine3 affine_b(B);
+    Tuple p = point(1, 2, 3);
+
+    BENCHMARK("matrixMultiply (Affine3)") {
+        return matrixMultiply(affine_a, affine_b);
+    };
+
+    // A chain of compositions, where the per-call benchmark overhead no
+    // longer hides the arithmetic
+    Matrix4 chain_m[16];
+    Affine3 chain_a[16];
+    for (int i = 0; i < 16; i++) {
+        chain_m[i] = matrixMultiply(rotation_y(0.1 * i), translation(i, 0, 1));
+        chain_a[i] = Affine3(chain_m[i]);
+    }
+
+    BENCHMARK("compose 16 transforms (Matrix4)") {
+        Matrix4 result = chain_m[0];
+        for (int i = 1; i < 16; i++) {
+            result = matrixMultiply(result, chain_m[i]);
+        }
+        return result;
+    };
+
+    BENCHMARK("compose 16 transforms (Affine3)") {
+        Affine3 result = chain_a[0];
+        for (int i = 1; i < 16; i++) {
+            result = matrixMultiply(result, chain_a[i]);
+        }
+        return result;
+    };
+
+    BENCHMARK("inverse (Affine3)") {
+        return inverse(affine_a);
+    };
+
+    BENCHMARK("transform_point (Affine3)") {
+        return transform_point(affine_a, p);
+    };
+}
@@ -0,0 +1,96 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "arena/arena.h"
+#include "ray/ray.h"
+
+TEST_CASE("Ray-sphere intersection", "[benchmark][ray]") {
+    Sphere s = sphere();
+    set_transform(s, matrixMultiply(translation(0, 0.5, 1), scaling(2, 1.5, 2)));
+    Ray hit_ray = ray(point(0, 0, -5), vector(0, 0, 1));
+    Ray miss_ray = ray(point(0, 10, -5), vector(0, 0, 1));
+
+    BENCHMARK("intersect (hit)") {
+        return intersect(s, hit_ray);
+    };
+
+    BENCHMARK("intersect (miss)") {
+        return intersect(s, miss_ray);
+    };
+
+    Intersections xs;
+    BENCHMARK("intersect into a reused list") {
+        xs.clear();
+        intersect(s, hit_ray, xs);
+        return xs.size();
+    };
+}
+
+TEST_CASE("Ray packet intersection", "[benchmark][ray]") {
+    Sphere s = sphere();
+    set_transform(s, scaling(2, 2, 2));
+    Ray rays[RAY_PACKET_SIZE] = {
+        ray(point(-0.1, 0, -5), vector(0, 0, 1)),
+        ray(point(0.1, 0, -5), vector(0, 0, 1)),
+        ray(point(-0.1, 0.1, -5), vector(0, 0, 1)),
+        ray(point(0.1, 0.1, -5), vector(0, 0, 1)),
+    };
+    RayPacket packet = ray_packet(rays);
+
+    BENCHMARK("intersect x4 (scalar)") {
+        Intersections xs;
+        for (const Ray& r : rays) {
+            intersect(s, r, xs);
+        }
+        return xs.size();
+    };
+
+    BENCHMARK("intersect (RayPacket)") {
+        return intersect(s, packet).mask;
+    };
+}
+
+TEST_CASE("Finding the hit", "[benchmark][intersections]") {
+    Sphere s = sphere();
+    Intersections xs = intersections({
+        intersection(5, s), intersection(7, s), intersection(-3, s), intersection(2, s)
+    });
+
+    BENCHMARK("hit") {
+        return hit(xs);
+    };
+}
+
+TEST_CASE("Surface normals", "[benchmark][sphere]") {
+    Sphere s = sphere();
+    set_transform(s, matrixMultiply(scaling(1, 0.5, 1), rotation_z(0.6)));
+    Tuple p = point(0, 0.70711, -0.70711);
+
+    BENCHMARK("normal_at") {
+        return normal_at(s, p);
+    };
+}
+
+TEST_CASE("Spilled intersection lists", "[benchmark][intersections]") {
+    // More hits than fit inline, so every fresh list allocates
+    Sphere s = sphere();
+    Ray r = ray(point(0, 0, -5), vector(0, 0, 1));
+    const int spheres = 16;
+
+    BENCHMARK("fresh list per ray (heap)") {
+        Intersections xs;
+        for (int i = 0; i < spheres; i++) {
+            intersect(s, r, xs);
+        }
+        return xs.size();
+    };
+
+    Arena arena;
+    BENCHMARK("fresh list per ray (arena)") {
+        arena.reset();
+        Intersections xs(arena);
+        for (int i = 0; i < spheres; i++) {
+            intersect(s, r, xs);
+        }
+        return xs.size();
+    };
+}
@@ -0,0 +1,66 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "scene/sphere_set.h"
+#include "scene/bvh.h"
+#include <cmath>
+#include <string>
+#include <vector>
+
+// A particle-style scene: many small spheres scattered through a box
+static std::vector<Sphere> particles(int count) {
+    std::vector<Sphere> spheres;
+    spheres.reserve(count);
+    for (int i = 0; i < count; i++) {
+        Sphere s = sphere();
+        set_transform(s, matrixMultiply(translation(std::sin(i * 1.7) * 50.0,
+                                                    std::cos(i * 2.3) * 50.0,
+                                                    std::sin(i * 0.31) * 50.0),
+                                        scaling(0.1, 0.1, 0.1)));
+        spheres.push_back(s);
+    }
+    return spheres;
+}
+
+TEST_CASE("One ray against many spheres", "[benchmark][scene]") {
+    std::vector<Sphere> spheres = particles(100000);
+    SphereSet set;
+    set.reserve(spheres.size());
+    for (const Sphere& s : spheres) {
+        set.add(s);
+    }
+    Ray r = ray(point(0, 0, -100), normalize(vector(0.01, 0.02, 1)));
+
+    BENCHMARK("intersect each Sphere (100k)") {
+        Intersections xs;
+        for (const Sphere& s : spheres) {
+            intersect(s, r, xs);
+        }
+        return hit(xs).has_value();
+    };
+
+    BENCHMARK("hit (SphereSet, 100k)") {
+        return hit(set, r).has_value();
+    };
+}
+
+TEST_CASE("BVH build and traversal", "[benchmark][scene]") {
+    std::vector<Sphere> build_input = particles(10000);
+    BENCHMARK("Bvh build (10000)") {
+        return Bvh(build_input).size();
+    };
+
+    for (int count : {1000, 100000}) {
+        std::vector<Sphere> spheres = particles(count);
+        Bvh bvh(spheres);
+        std::string label = " (" + std::to_string(count) + ")";
+
+        BENCHMARK("hit (Bvh)" + label) {
+            int hits = 0;
+            for (int i = 0; i < 64; i++) {
+                Ray r = ray(point(0, 0, -100), normalize(vector(std::sin(i) * 0.3, std::cos(i) * 0.3, 1)));
+                hits += hit(bvh, r).has_value() ? 1 : 0;
+            }
+            return hits;
+        };
+    }
+}
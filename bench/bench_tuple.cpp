@@ -0,0 +1,109 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "tuple/tuple.h"
+#include <cstdio>
+#include <string>
+
+TEST_CASE("Tuple arithmetic", "[benchmark][tuple]") {
+    Tuple a = vector(1.5, -2.25, 3.125);
+    Tuple b = vector(-0.5, 4.0, 0.75);
+
+    BENCHMARK("add") {
+        return add(a, b);
+    };
+
+    BENCHMARK("dot") {
+        return dot(a, b);
+    };
+
+    BENCHMARK("magnitude") {
+        return magnitude(a);
+    };
+
+    BENCHMARK("normalize") {
+        return normalize(a);
+    };
+}
+
+TEST_CASE("Single-precision tuple arithmetic", "[benchmark][tuple]") {
+    Tuplef a = vector<float>(1.5f, -2.25f, 3.125f);
+    Tuplef b = vector<float>(-0.5f, 4.0f, 0.75f);
+
+    BENCHMARK("add (float)") {
+        return add(a, b);
+    };
+
+    BENCHMARK("dot (float)") {
+        return dot(a, b);
+    };
+
+    BENCHMARK("normalize (float)") {
+        return normalize(a);
+    };
+}
+
+// Fills a canvas with a gradient so every component width (1-3 digits)
+// shows up in the encoded output
+static Canvas gradient_canvas(int width, int height) {
+    Canvas c = canvas(width, height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            write_pixel(c, x, y, color(double(x) / width, double(y) / height, 0.5));
+        }
+    }
+    return c;
+}
+
+TEST_CASE("PPM encoding", "[benchmark][canvas]") {
+    for (int size : {64, 256, 1024}) {
+        Canvas c = gradient_canvas(size, size);
+        std::string label = std::to_string(size) + "x" + std::to_string(size);
+
+        BENCHMARK("canvas_to_ppm P3 " + label) {
+            return canvas_to_ppm(c);
+        };
+
+        BENCHMARK("canvas_to_ppm P6 " + label) {
+            return canvas_to_ppm(c, PpmFormat::P6);
+        };
+    }
+}
+
+TEST_CASE("Writing PPM files", "[benchmark][canvas]") {
+    Canvas c = gradient_canvas(2048, 2048);
+    const std::string path = "bench_output.ppm";
+
+    for (PpmFormat format : {PpmFormat::P3, PpmFormat::P6}) {
+        std::string label = format == PpmFormat::P3 ? " P3 2048x2048" : " P6 2048x2048";
+
+        BENCHMARK("save_canvas_to_file" + label) {
+            save_canvas_to_file(c, path, format);
+        };
+
+        BENCHMARK("save_ppm_mapped" + label) {
+            return save_ppm_mapped(c, path, format);
+        };
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Reading PPM files", "[benchmark][canvas]") {
+    Canvas c = gradient_canvas(2048, 2048);
+    const std::string path = "bench_input.ppm";
+
+    for (PpmFormat format : {PpmFormat::P3, PpmFormat::P6}) {
+        std::string label = format == PpmFormat::P3 ? " P3 2048x2048" : " P6 2048x2048";
+        save_canvas_to_file(c, path, format);
+        Canvas loaded = canvas(1, 1);
+
+        BENCHMARK("load_ppm" + label) {
+            return load_ppm(path, loaded);
+        };
+    }
+    std::remove(path.c_str());
+
+    Canvas other = gradient_canvas(2048, 2048);
+    BENCHMARK("diff_canvases 2048x2048") {
+        return diff_canvases(c, other).max_error;
+    };
+}
@@ -0,0 +1,131 @@
+#include "tiled_canvas.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+// Pixels are read and written directly as the mapped file's bytes
+static_assert(std::is_trivially_copyable<Color>::value, "Color must be trivially copyable");
+
+TiledCanvas::TiledCanvas(const std::string& path, int width, int height, int tile_size)
+    : width_(width), height_(height), tile_size_(std::max(1, tile_size)) {
+    if (width <= 0 || height <= 0) {
+        release();
+        return;
+    }
+    tiles_x_ = (width + tile_size_ - 1) / tile_size_;
+    tiles_y_ = (height + tile_size_ - 1) / tile_size_;
+    bytes_ = static_cast<size_t>(tiles_x_) * tiles_y_ * tile_size_ * tile_size_ * sizeof(Color);
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        release();
+        return;
+    }
+    // Sizing the file leaves it sparse: no disk space is used until a tile
+    // is written, and unwritten tiles read back as zeros (black)
+    if (::ftruncate(fd_, static_cast<off_t>(bytes_)) != 0) {
+        release();
+        return;
+    }
+    void* mapping = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        release();
+        return;
+    }
+    pixels_ = static_cast<Color*>(mapping);
+}
+
+TiledCanvas::~TiledCanvas() {
+    release();
+}
+
+TiledCanvas::TiledCanvas(TiledCanvas&& other) noexcept {
+    *this = std::move(other);
+}
+
+TiledCanvas& TiledCanvas::operator=(TiledCanvas&& other) noexcept {
+    if (this != &other) {
+        release();
+        width_ = other.width_;
+        height_ = other.height_;
+        tile_size_ = other.tile_size_;
+        tiles_x_ = other.tiles_x_;
+        tiles_y_ = other.tiles_y_;
+        fd_ = other.fd_;
+        bytes_ = other.bytes_;
+        pixels_ = other.pixels_;
+        other.fd_ = -1;
+        other.bytes_ = 0;
+        other.pixels_ = nullptr;
+    }
+    return *this;
+}
+
+void TiledCanvas::release() {
+    if (pixels_ != nullptr) {
+        ::munmap(pixels_, bytes_);
+        pixels_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    // Without a mapping the canvas has no pixels, so every access is out
+    // of bounds
+    width_ = 0;
+    height_ = 0;
+    tiles_x_ = 0;
+    tiles_y_ = 0;
+    bytes_ = 0;
+}
+
+bool TiledCanvas::flush(bool wait) {
+    if (pixels_ == nullptr) {
+        return false;
+    }
+    return ::msync(pixels_, bytes_, wait ? MS_SYNC : MS_ASYNC) == 0;
+}
+
+void write_pixel(TiledCanvas& c, int x, int y, const Color& color) {
+    if (x >= 0 && x < c.width() && y >= 0 && y < c.height()) {
+        c.pixel(x, y) = color;
+    }
+}
+
+Color pixel_at(const TiledCanvas& c, int x, int y) {
+    if (x >= 0 && x < c.width() && y >= 0 && y < c.height()) {
+        return c.pixel(x, y);
+    }
+    return color(0, 0, 0); // Return black for out-of-bounds
+}
+
+bool write_ppm(int fd, const TiledCanvas& c, PpmFormat format) {
+    if (!c.valid()) {
+        return false;
+    }
+    // Gather each image row from the tiles it crosses; only one row of
+    // pixels is ever held outside the mapping
+    std::vector<Color> row(static_cast<size_t>(c.width()));
+    int size = c.tile_size();
+    return write_ppm_rows(fd, c.width(), c.height(), format, [&](int y) {
+        for (int tx = 0; tx < c.tiles_x(); tx++) {
+            const Color* source = c.tile(tx, y / size) + static_cast<size_t>(y % size) * size;
+            int x0 = tx * size;
+            int count = std::min(size, c.width() - x0);
+            std::copy(source, source + count, row.begin() + x0);
+        }
+        return static_cast<const Color*>(row.data());
+    });
+}
+
+void save_canvas_to_file(const TiledCanvas& c, const std::string& filename, PpmFormat format) {
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    write_ppm(fd, c, format);
+    ::close(fd);
+}
@@ -0,0 +1,85 @@
+#ifndef TILED_CANVAS_H
+#define TILED_CANVAS_H
+
+#include "tuple/tuple.h"
+#include <cstddef>
+#include <string>
+
+// Framebuffer for images too large to keep in memory. Pixels live in a file
+// mapped with MAP_SHARED, grouped into square tiles of tile_size x
+// tile_size pixels, each stored contiguously (row-major inside the tile,
+// tiles row-major across the image; edge tiles are padded to full size).
+// Rendering one tile touches one contiguous range of pages, and the OS
+// writes back and evicts tiles that are no longer being used.
+class TiledCanvas {
+public:
+    static constexpr int DEFAULT_TILE_SIZE = 64;
+
+    // Creates or truncates the file at path and maps a black image of
+    // width x height pixels. Check valid() before use; the file is kept
+    // when the canvas is destroyed.
+    TiledCanvas(const std::string& path, int width, int height,
+                int tile_size = DEFAULT_TILE_SIZE);
+    ~TiledCanvas();
+
+    TiledCanvas(const TiledCanvas&) = delete;
+    TiledCanvas& operator=(const TiledCanvas&) = delete;
+    TiledCanvas(TiledCanvas&& other) noexcept;
+    TiledCanvas& operator=(TiledCanvas&& other) noexcept;
+
+    // False if the file could not be created, sized or mapped; such a
+    // canvas is 0 x 0
+    bool valid() const { return pixels_ != nullptr; }
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int tile_size() const { return tile_size_; }
+    int tiles_x() const { return tiles_x_; }
+    int tiles_y() const { return tiles_y_; }
+
+    // Pixels of tile (tx, ty): row r of the tile starts at
+    // tile(tx, ty) + r * tile_size() (no bounds checking)
+    Color* tile(int tx, int ty) { return pixels_ + tile_offset(tx, ty); }
+    const Color* tile(int tx, int ty) const { return pixels_ + tile_offset(tx, ty); }
+
+    // Pixel (x, y) (no bounds checking)
+    Color& pixel(int x, int y) { return pixels_[pixel_offset(x, y)]; }
+    const Color& pixel(int x, int y) const { return pixels_[pixel_offset(x, y)]; }
+
+    // Schedules write-back of every dirty page; with wait, returns once the
+    // data is on disk. Returns false on failure.
+    bool flush(bool wait = true);
+
+private:
+    size_t tile_offset(int tx, int ty) const {
+        return (static_cast<size_t>(ty) * tiles_x_ + tx) * tile_size_ * tile_size_;
+    }
+
+    size_t pixel_offset(int x, int y) const {
+        return tile_offset(x / tile_size_, y / tile_size_) +
+               static_cast<size_t>(y % tile_size_) * tile_size_ + x % tile_size_;
+    }
+
+    void release();
+
+    int width_ = 0;
+    int height_ = 0;
+    int tile_size_ = DEFAULT_TILE_SIZE;
+    int tiles_x_ = 0;
+    int tiles_y_ = 0;
+    int fd_ = -1;
+    size_t bytes_ = 0;
+    Color* pixels_ = nullptr;
+};
+
+// Same semantics as the Canvas versions: writes outside the image are
+// ignored, reads outside it return black
+void write_pixel(TiledCanvas& c, int x, int y, const Color& color);
+Color pixel_at(const TiledCanvas& c, int x, int y);
+
+// Encodes straight from the mapping, one row at a time
+bool write_ppm(int fd, const TiledCanvas& c, PpmFormat format = PpmFormat::P3);
+void save_canvas_to_file(const TiledCanvas& c, const std::string& filename,
+                         PpmFormat format = PpmFormat::P3);
+
+#endif // TILED_CANVAS_H
@@ -0,0 +1,192 @@
+#ifndef AFFINE_H
+#define AFFINE_H
+
+#include <array>
+#include "matrix/matrix.h"
+#include "tuple/tuple.h"
+
+// Affine transform stored as the top three rows of a 4x4 matrix: a 3x3
+// linear block in columns 0-2 and the translation in column 3. The bottom
+// row is always (0, 0, 0, 1) and is never stored or multiplied, which is
+// what makes composition, inversion and tuple transforms cheaper than the
+// general 4x4 versions. Everything is constexpr: composition uses
+// affine_product_scalar during constant evaluation and the packed
+// affine_product kernel in matrix.cpp at run time.
+template <typename T>
+class Affine3T {
+public:
+    alignas(32) std::array<T, 12> data;
+
+    // Zero-initialized transform (zero linear block, no translation)
+    constexpr Affine3T() : data{} {}
+
+    // Conversions from a 4x4 matrix; the bottom row is dropped, so the
+    // matrix must be affine for the result to be equivalent
+    constexpr explicit Affine3T(const SquareMatrix<4, T>& m) : data{} {
+        for (int i = 0; i < 12; i++) {
+            data[i] = m.data[i];
+        }
+    }
+
+    explicit Affine3T(const Matrix& m) : Affine3T(SquareMatrix<4, T>(m)) {}
+
+    constexpr T& operator()(int row, int col) { return data[row * 4 + col]; }
+    constexpr const T& operator()(int row, int col) const { return data[row * 4 + col]; }
+
+    constexpr bool operator==(const Affine3T& other) const {
+        for (int i = 0; i < 12; i++) {
+            if (absolute(data[i] - other.data[i]) >= Precision<T>::epsilon) {
+                return false;
+            }
+        }
+        return true;
+    }
+    constexpr bool operator!=(const Affine3T& other) const { return !(*this == other); }
+};
+
+using Affine3 = Affine3T<double>;
+using Affine3f = Affine3T<float>;
+
+// Factory functions
+template <typename T = double>
+constexpr Affine3T<T> identity_affine() {
+    Affine3T<T> result;
+    result(0, 0) = 1;
+    result(1, 1) = 1;
+    result(2, 2) = 1;
+    return result;
+}
+
+// The full 4x4 matrix, with the implicit bottom row filled in
+template <typename T>
+constexpr SquareMatrix<4, T> to_matrix(const Affine3T<T>& a) {
+    SquareMatrix<4, T> result;
+    for (int i = 0; i < 12; i++) {
+        result.data[i] = a.data[i];
+    }
+    result(3, 3) = 1;
+    return result;
+}
+
+// Portable composition, used in constant expressions
+template <typename T>
+constexpr Affine3T<T> affine_product_scalar(const Affine3T<T>& a, const Affine3T<T>& b) {
+    // Row i of the product is a's row i against b's columns; b's implicit
+    // bottom row only contributes a(i, 3) to the translation column
+    Affine3T<T> result;
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 4; col++) {
+            result(row, col) = a(row, 0) * b(0, col) +
+                               a(row, 1) * b(1, col) +
+                               a(row, 2) * b(2, col);
+        }
+        result(row, 3) += a(row, 3);
+    }
+    return result;
+}
+
+// Packed run-time composition: each result row is a weighted sum of b's
+// three rows. Instantiated for float and double in matrix.cpp.
+template <typename T>
+Affine3T<T> affine_product(const Affine3T<T>& a, const Affine3T<T>& b);
+
+// Composition: the transform that applies b first, then a. Costs 36
+// multiplies against 64 for the 4x4 product.
+template <typename T>
+constexpr Affine3T<T> matrixMultiply(const Affine3T<T>& a, const Affine3T<T>& b) {
+    if (constant_evaluated()) {
+        return affine_product_scalar(a, b);
+    }
+    return affine_product(a, b);
+}
+
+// Same as multiply(to_matrix(a), t); w passes through unchanged
+template <typename T>
+constexpr TupleT<T> multiply(const Affine3T<T>& a, const TupleT<T>& t) {
+    T x = a(0, 0) * t.x + a(0, 1) * t.y + a(0, 2) * t.z + a(0, 3) * t.w;
+    T y = a(1, 0) * t.x + a(1, 1) * t.y + a(1, 2) * t.z + a(1, 3) * t.w;
+    T z = a(2, 0) * t.x + a(2, 1) * t.y + a(2, 2) * t.z + a(2, 3) * t.w;
+    return TupleT<T>(x, y, z, t.w);
+}
+
+// Shortcuts for tuples whose w is known: points pick up the translation,
+// vectors only go through the linear block
+template <typename T>
+constexpr TupleT<T> transform_point(const Affine3T<T>& a, const TupleT<T>& p) {
+    T x = a(0, 0) * p.x + a(0, 1) * p.y + a(0, 2) * p.z + a(0, 3);
+    T y = a(1, 0) * p.x + a(1, 1) * p.y + a(1, 2) * p.z + a(1, 3);
+    T z = a(2, 0) * p.x + a(2, 1) * p.y + a(2, 2) * p.z + a(2, 3);
+    return TupleT<T>(x, y, z, 1);
+}
+
+template <typename T>
+constexpr TupleT<T> transform_vector(const Affine3T<T>& a, const TupleT<T>& v) {
+    T x = a(0, 0) * v.x + a(0, 1) * v.y + a(0, 2) * v.z;
+    T y = a(1, 0) * v.x + a(1, 1) * v.y + a(1, 2) * v.z;
+    T z = a(2, 0) * v.x + a(2, 1) * v.y + a(2, 2) * v.z;
+    return TupleT<T>(x, y, z, 0);
+}
+
+// Multiplies v by the transpose of the linear block: given the inverse of
+// a shape's transform, maps an object-space normal to world space
+template <typename T>
+constexpr TupleT<T> transform_normal(const Affine3T<T>& inverse, const TupleT<T>& v) {
+    // Column j of the linear block is row j of its transpose. The
+    // translation would only reach w, which a normal drops anyway.
+    T x = inverse(0, 0) * v.x + inverse(1, 0) * v.y + inverse(2, 0) * v.z;
+    T y = inverse(0, 1) * v.x + inverse(1, 1) * v.y + inverse(2, 1) * v.z;
+    T z = inverse(0, 2) * v.x + inverse(1, 2) * v.y + inverse(2, 2) * v.z;
+    return TupleT<T>(x, y, z, 0);
+}
+
+// Determinant of the linear block, which is that of the whole 4x4 matrix
+template <typename T>
+constexpr T determinant(const Affine3T<T>& a) {
+    return a(0, 0) * (a(1, 1) * a(2, 2) - a(1, 2) * a(2, 1)) -
+           a(0, 1) * (a(1, 0) * a(2, 2) - a(1, 2) * a(2, 0)) +
+           a(0, 2) * (a(1, 0) * a(2, 1) - a(1, 1) * a(2, 0));
+}
+
+template <typename T>
+constexpr bool is_invertible(const Affine3T<T>& a) {
+    return absolute(determinant(a)) >= Precision<T>::epsilon;
+}
+
+// Inverts the linear block and moves the translation through it; returns
+// the zero transform if a is not invertible
+template <typename T>
+constexpr Affine3T<T> inverse(const Affine3T<T>& a) {
+    // The cofactors of the 3x3 block; its inverse is their transpose
+    // divided by the determinant
+    T c00 = a(1, 1) * a(2, 2) - a(1, 2) * a(2, 1);
+    T c01 = a(1, 2) * a(2, 0) - a(1, 0) * a(2, 2);
+    T c02 = a(1, 0) * a(2, 1) - a(1, 1) * a(2, 0);
+    T det = a(0, 0) * c00 + a(0, 1) * c01 + a(0, 2) * c02;
+
+    Affine3T<T> result;
+    if (absolute(det) < Precision<T>::epsilon) {
+        // Zero transform as error indicator
+        return result;
+    }
+    T inv_det = 1 / det;
+
+    result(0, 0) = c00 * inv_det;
+    result(1, 0) = c01 * inv_det;
+    result(2, 0) = c02 * inv_det;
+    result(0, 1) = (a(0, 2) * a(2, 1) - a(0, 1) * a(2, 2)) * inv_det;
+    result(1, 1) = (a(0, 0) * a(2, 2) - a(0, 2) * a(2, 0)) * inv_det;
+    result(2, 1) = (a(0, 1) * a(2, 0) - a(0, 0) * a(2, 1)) * inv_det;
+    result(0, 2) = (a(0, 1) * a(1, 2) - a(0, 2) * a(1, 1)) * inv_det;
+    result(1, 2) = (a(0, 2) * a(1, 0) - a(0, 0) * a(1, 2)) * inv_det;
+    result(2, 2) = (a(0, 0) * a(1, 1) - a(0, 1) * a(1, 0)) * inv_det;
+
+    // Undo the translation in the inverted frame: -inverse(block) * t
+    for (int row = 0; row < 3; row++) {
+        result(row, 3) = -(result(row, 0) * a(0, 3) +
+                           result(row, 1) * a(1, 3) +
+                           result(row, 2) * a(2, 3));
+    }
+    return result;
+}
+
+#endif // AFFINE_H
@@ -1,4 +1,7 @@
 #include "matrix.h"
+#include "affine.h"
+#include "tuple/simd.h"
+#include "stats/stats.h"
 #include <cmath>
 
 Matrix::Matrix(int rows, int cols) 
@@ -43,16 +46,6 @@ Matrix matrix2x2(const std::vector<std::vector<double>>& values) {
     return Matrix(2, 2, values);
 }
 
-Matrix identity_matrix() {
-    // 4x4 identity matrix: 1s on diagonal, 0s elsewhere
-    return matrix4x4({
-        {1, 0, 0, 0},
-        {0, 1, 0, 0},
-        {0, 0, 1, 0},
-        {0, 0, 0, 1}
-    });
-}
-
 bool compareMatrix(Matrix a, Matrix b) {
     // Compare if matrix a rows and columns match matrix b's
     if (a.rows != b.rows || a.cols != b.cols) {
@@ -173,6 +166,7 @@ bool is_invertible(const Matrix& m) {
 }
 
 Matrix inverse(const Matrix& m) {
+    count(Counter::Inverses);
     // Fail if matrix is not invertible
     if (!is_invertible(m)) {
         // Return empty matrix as error indicator
@@ -194,85 +188,355 @@ Matrix inverse(const Matrix& m) {
     return result;
 }
 
-Matrix translation(double x, double y, double z) {
-    // Translation matrix: identity matrix with x, y, z in the last column
-    Matrix result = identity_matrix();
-    result.data[0][3] = x;
-    result.data[1][3] = y;
-    result.data[2][3] = z;
-    return result;
+// Fixed-size overloads
+
+// Row-by-tuple products behind multiply(); the non-template overloads below
+// are the packed kernels and win overload resolution where they exist
+template <typename T>
+static TupleT<T> row_products(const SquareMatrix<4, T>& m, const TupleT<T>& t) {
+    T x = m(0, 0) * t.x + m(0, 1) * t.y + m(0, 2) * t.z + m(0, 3) * t.w;
+    T y = m(1, 0) * t.x + m(1, 1) * t.y + m(1, 2) * t.z + m(1, 3) * t.w;
+    T z = m(2, 0) * t.x + m(2, 1) * t.y + m(2, 2) * t.z + m(2, 3) * t.w;
+    T w = m(3, 0) * t.x + m(3, 1) * t.y + m(3, 2) * t.z + m(3, 3) * t.w;
+
+    return TupleT<T>(x, y, z, w);
 }
 
-Matrix scaling(double x, double y, double z) {
-    // Scaling matrix: scaling factors on the diagonal
-    Matrix result = identity_matrix();
-    result.data[0][0] = x;
-    result.data[1][1] = y;
-    result.data[2][2] = z;
-    return result;
+#if defined(RT_SIMD_AVX)
+static Tuple row_products(const Matrix4& m, const Tuple& t) {
+    // Multiply each row by the tuple, then reduce the four products
+    // horizontally so lane i holds row i's dot product
+    __m256d v = load(t);
+    __m256d p0 = _mm256_mul_pd(_mm256_load_pd(&m.data[0]), v);
+    __m256d p1 = _mm256_mul_pd(_mm256_load_pd(&m.data[4]), v);
+    __m256d p2 = _mm256_mul_pd(_mm256_load_pd(&m.data[8]), v);
+    __m256d p3 = _mm256_mul_pd(_mm256_load_pd(&m.data[12]), v);
+    __m256d h01 = _mm256_hadd_pd(p0, p1);
+    __m256d h23 = _mm256_hadd_pd(p2, p3);
+    __m256d swapped = _mm256_permute2f128_pd(h01, h23, 0x21);
+    __m256d blended = _mm256_blend_pd(h01, h23, 0xC);
+    return store(_mm256_add_pd(swapped, blended));
+}
+#elif defined(RT_SIMD_SSE2)
+static Tuple row_products(const Matrix4& m, const Tuple& t) {
+    Packed2 v = load(t);
+    __m128d r[4];
+    for (int i = 0; i < 4; i++) {
+        r[i] = _mm_add_pd(_mm_mul_pd(_mm_load_pd(&m.data[i * 4]), v.xy),
+                          _mm_mul_pd(_mm_load_pd(&m.data[i * 4 + 2]), v.zw));
+    }
+    __m128d xy = _mm_add_pd(_mm_unpacklo_pd(r[0], r[1]), _mm_unpackhi_pd(r[0], r[1]));
+    __m128d zw = _mm_add_pd(_mm_unpacklo_pd(r[2], r[3]), _mm_unpackhi_pd(r[2], r[3]));
+    return store(Packed2{xy, zw});
 }
+#endif
 
-Matrix rotation_x(double radians) {
-    // Rotation matrix around x-axis by r radians:
-    // [1,     0,        0,     0]
-    // [0,  cos r,  -sin r,     0]
-    // [0,  sin r,   cos r,     0]
-    // [0,     0,        0,     1]
-    Matrix result = identity_matrix();
-    double cos_r = std::cos(radians);
-    double sin_r = std::sin(radians);
-    result.data[1][1] = cos_r;
-    result.data[1][2] = -sin_r;
-    result.data[2][1] = sin_r;
-    result.data[2][2] = cos_r;
-    return result;
+#if defined(RT_SIMD)
+static Tuplef row_products(const Matrix4f& m, const Tuplef& t) {
+    // A whole float matrix is four SSE registers: transpose the products so
+    // each register holds one component of every row, then sum them
+    __m128 v = load(t);
+    __m128 p0 = _mm_mul_ps(_mm_load_ps(&m.data[0]), v);
+    __m128 p1 = _mm_mul_ps(_mm_load_ps(&m.data[4]), v);
+    __m128 p2 = _mm_mul_ps(_mm_load_ps(&m.data[8]), v);
+    __m128 p3 = _mm_mul_ps(_mm_load_ps(&m.data[12]), v);
+    _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+    return store(_mm_add_ps(_mm_add_ps(p0, p1), _mm_add_ps(p2, p3)));
 }
+#endif
 
-Matrix rotation_y(double radians) {
-    // Rotation matrix around y-axis by r radians:
-    // [cos r,  0,  sin r,  0]
-    // [0,      1,  0,      0]
-    // [-sin r, 0,  cos r,  0]
-    // [0,      0,  0,      1]
-    Matrix result = identity_matrix();
-    double cos_r = std::cos(radians);
-    double sin_r = std::sin(radians);
-    result.data[0][0] = cos_r;
-    result.data[0][2] = sin_r;
-    result.data[2][0] = -sin_r;
-    result.data[2][2] = cos_r;
+template <typename T>
+TupleT<T> multiply(const SquareMatrix<4, T>& m, const TupleT<T>& t) {
+    return row_products(m, t);
+}
+
+// Affine composition; as with row_products, the packed overloads below win
+// where they exist
+template <typename T>
+static Affine3T<T> affine_rows(const Affine3T<T>& a, const Affine3T<T>& b) {
+    return affine_product_scalar(a, b);
+}
+
+#if defined(RT_SIMD_AVX)
+static Affine3 affine_rows(const Affine3& a, const Affine3& b) {
+    __m256d b0 = _mm256_load_pd(&b.data[0]);
+    __m256d b1 = _mm256_load_pd(&b.data[4]);
+    __m256d b2 = _mm256_load_pd(&b.data[8]);
+    // b's implicit bottom row, which carries a's translation into the last
+    // lane
+    __m256d b3 = _mm256_set_pd(1.0, 0.0, 0.0, 0.0);
+    Affine3 result;
+    for (int row = 0; row < 3; row++) {
+        const double* weights = &a.data[row * 4];
+        // Summed as a tree to keep the dependency chain short
+        __m256d p01 = _mm256_add_pd(_mm256_mul_pd(_mm256_broadcast_sd(&weights[0]), b0),
+                                    _mm256_mul_pd(_mm256_broadcast_sd(&weights[1]), b1));
+        __m256d p23 = _mm256_add_pd(_mm256_mul_pd(_mm256_broadcast_sd(&weights[2]), b2),
+                                    _mm256_mul_pd(_mm256_broadcast_sd(&weights[3]), b3));
+        _mm256_store_pd(&result.data[row * 4], _mm256_add_pd(p01, p23));
+    }
+    return result;
+}
+#elif defined(RT_SIMD_SSE2)
+static Affine3 affine_rows(const Affine3& a, const Affine3& b) {
+    // Each row as two halves: columns 0-1 and columns 2-3
+    __m128d lo[3], hi[3];
+    for (int k = 0; k < 3; k++) {
+        lo[k] = _mm_load_pd(&b.data[k * 4]);
+        hi[k] = _mm_load_pd(&b.data[k * 4 + 2]);
+    }
+    Affine3 result;
+    for (int row = 0; row < 3; row++) {
+        __m128d sum_lo = _mm_setzero_pd();
+        __m128d sum_hi = _mm_set_pd(a(row, 3), 0.0);
+        for (int k = 0; k < 3; k++) {
+            __m128d weight = _mm_set1_pd(a(row, k));
+            sum_lo = _mm_add_pd(sum_lo, _mm_mul_pd(weight, lo[k]));
+            sum_hi = _mm_add_pd(sum_hi, _mm_mul_pd(weight, hi[k]));
+        }
+        _mm_store_pd(&result.data[row * 4], sum_lo);
+        _mm_store_pd(&result.data[row * 4 + 2], sum_hi);
+    }
     return result;
 }
+#endif
 
-Matrix rotation_z(double radians) {
-    // Rotation matrix around z-axis by r radians:
-    // [cos r, -sin r, 0, 0]
-    // [sin r,  cos r, 0, 0]
-    // [0,      0,    1, 0]
-    // [0,      0,    0, 1]
-    Matrix result = identity_matrix();
-    double cos_r = std::cos(radians);
-    double sin_r = std::sin(radians);
-    result.data[0][0] = cos_r;
-    result.data[0][1] = -sin_r;
-    result.data[1][0] = sin_r;
-    result.data[1][1] = cos_r;
+#if defined(RT_SIMD)
+static Affine3f affine_rows(const Affine3f& a, const Affine3f& b) {
+    __m128 b0 = _mm_load_ps(&b.data[0]);
+    __m128 b1 = _mm_load_ps(&b.data[4]);
+    __m128 b2 = _mm_load_ps(&b.data[8]);
+    Affine3f result;
+    for (int row = 0; row < 3; row++) {
+        __m128 sum = _mm_set_ps(a(row, 3), 0.0f, 0.0f, 0.0f);
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a(row, 0)), b0));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a(row, 1)), b1));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a(row, 2)), b2));
+        _mm_store_ps(&result.data[row * 4], sum);
+    }
     return result;
 }
+#endif
+
+template <typename T>
+Affine3T<T> affine_product(const Affine3T<T>& a, const Affine3T<T>& b) {
+    return affine_rows(a, b);
+}
+
+template <typename T>
+T determinant(const SquareMatrix<2, T>& m) {
+    return m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0);
+}
 
-Matrix shearing(double x_y, double x_z, double y_x, double y_z, double z_x, double z_y) {
-    // Shearing: one coordinate moves in proportion to another.
-    // x' = x + x_y*y + x_z*z,  y' = y_x*x + y + y_z*z,  z' = z_x*x + z_y*y + z
-    // [1,   x_y, x_z, 0]
-    // [y_x, 1,   y_z, 0]
-    // [z_x, z_y, 1,   0]
-    // [0,   0,   0,   1]
-    Matrix result = identity_matrix();
-    result.data[0][1] = x_y;
-    result.data[0][2] = x_z;
-    result.data[1][0] = y_x;
-    result.data[1][2] = y_z;
-    result.data[2][0] = z_x;
-    result.data[2][1] = z_y;
+template <typename T>
+T determinant(const SquareMatrix<3, T>& m) {
+    return m(0, 0) * cofactor(m, 0, 0) +
+           m(0, 1) * cofactor(m, 0, 1) +
+           m(0, 2) * cofactor(m, 0, 2);
+}
+
+// The twelve 2x2 sub-determinants a closed-form 4x4 inverse is built from:
+// s[] come from rows 0-1 and c[] from rows 2-3 (Laplace expansion by
+// complementary minors). Each is shared by several cofactors, so a full
+// inverse costs 12 of these instead of 16 recursive 3x3 expansions.
+template <typename T>
+struct SubDeterminants {
+    T s[6];
+    T c[6];
+};
+
+template <typename T>
+static SubDeterminants<T> sub_determinants(const SquareMatrix<4, T>& m) {
+    SubDeterminants<T> d;
+    d.s[0] = m(0, 0) * m(1, 1) - m(1, 0) * m(0, 1);
+    d.s[1] = m(0, 0) * m(1, 2) - m(1, 0) * m(0, 2);
+    d.s[2] = m(0, 0) * m(1, 3) - m(1, 0) * m(0, 3);
+    d.s[3] = m(0, 1) * m(1, 2) - m(1, 1) * m(0, 2);
+    d.s[4] = m(0, 1) * m(1, 3) - m(1, 1) * m(0, 3);
+    d.s[5] = m(0, 2) * m(1, 3) - m(1, 2) * m(0, 3);
+
+    d.c[0] = m(2, 0) * m(3, 1) - m(3, 0) * m(2, 1);
+    d.c[1] = m(2, 0) * m(3, 2) - m(3, 0) * m(2, 2);
+    d.c[2] = m(2, 0) * m(3, 3) - m(3, 0) * m(2, 3);
+    d.c[3] = m(2, 1) * m(3, 2) - m(3, 1) * m(2, 2);
+    d.c[4] = m(2, 1) * m(3, 3) - m(3, 1) * m(2, 3);
+    d.c[5] = m(2, 2) * m(3, 3) - m(3, 2) * m(2, 3);
+    return d;
+}
+
+template <typename T>
+static T determinant(const SubDeterminants<T>& d) {
+    return d.s[0] * d.c[5] - d.s[1] * d.c[4] + d.s[2] * d.c[3] +
+           d.s[3] * d.c[2] - d.s[4] * d.c[1] + d.s[5] * d.c[0];
+}
+
+template <typename T>
+T determinant(const SquareMatrix<4, T>& m) {
+    return determinant(sub_determinants(m));
+}
+
+// Copies every element of m except those in the given row and column
+template <int N, typename T>
+static SquareMatrix<N - 1, T> fixed_submatrix(const SquareMatrix<N, T>& m, int row, int col) {
+    SquareMatrix<N - 1, T> sub;
+    int sub_row = 0;
+    for (int i = 0; i < N; i++) {
+        if (i == row)
+            continue;
+
+        int sub_column = 0;
+        for (int j = 0; j < N; j++) {
+            if (j == col)
+                continue;
+
+            sub(sub_row, sub_column) = m(i, j);
+            sub_column++;
+        }
+        sub_row++;
+    }
+    return sub;
+}
+
+template <typename T>
+SquareMatrix<3, T> submatrix(const SquareMatrix<4, T>& m, int row, int col) {
+    return fixed_submatrix(m, row, col);
+}
+
+template <typename T>
+SquareMatrix<2, T> submatrix(const SquareMatrix<3, T>& m, int row, int col) {
+    return fixed_submatrix(m, row, col);
+}
+
+template <typename T>
+T minor(const SquareMatrix<4, T>& m, int row, int col) {
+    return determinant(submatrix(m, row, col));
+}
+
+template <typename T>
+T minor(const SquareMatrix<3, T>& m, int row, int col) {
+    return determinant(submatrix(m, row, col));
+}
+
+template <typename T>
+T cofactor(const SquareMatrix<4, T>& m, int row, int col) {
+    T min = minor(m, row, col);
+    return ((row + col) % 2 == 1) ? -min : min;
+}
+
+template <typename T>
+T cofactor(const SquareMatrix<3, T>& m, int row, int col) {
+    T min = minor(m, row, col);
+    return ((row + col) % 2 == 1) ? -min : min;
+}
+
+template <typename T>
+bool is_invertible(const SquareMatrix<4, T>& m) {
+    return std::abs(determinant(m)) >= Precision<T>::epsilon;
+}
+
+#if defined(RT_SIMD_AVX)
+// Writes the adjugate of m scaled by inv_det into result. Each row of the
+// inverse is three 4-wide multiply-adds: the columns of m (with rows
+// reordered 1,0,3,2) against broadcast pairs of sub-determinants.
+static void scaled_adjugate(const Matrix4& m, const SubDeterminants<double>& d,
+                            double inv_det, Matrix4& result) {
+    __m256d k[4];
+    for (int j = 0; j < 4; j++) {
+        k[j] = _mm256_setr_pd(m(1, j), m(0, j), m(3, j), m(2, j));
+    }
+    __m256d e[6];
+    for (int i = 0; i < 6; i++) {
+        e[i] = _mm256_setr_pd(d.c[i], d.c[i], d.s[i], d.s[i]);
+    }
+
+    // Alternating signs, folded together with 1/det
+    __m256d pos = _mm256_setr_pd(inv_det, -inv_det, inv_det, -inv_det);
+    __m256d neg = _mm256_setr_pd(-inv_det, inv_det, -inv_det, inv_det);
+
+    __m256d row0 = _mm256_sub_pd(_mm256_mul_pd(k[1], e[5]), _mm256_mul_pd(k[2], e[4]));
+    row0 = _mm256_add_pd(row0, _mm256_mul_pd(k[3], e[3]));
+    __m256d row1 = _mm256_sub_pd(_mm256_mul_pd(k[0], e[5]), _mm256_mul_pd(k[2], e[2]));
+    row1 = _mm256_add_pd(row1, _mm256_mul_pd(k[3], e[1]));
+    __m256d row2 = _mm256_sub_pd(_mm256_mul_pd(k[0], e[4]), _mm256_mul_pd(k[1], e[2]));
+    row2 = _mm256_add_pd(row2, _mm256_mul_pd(k[3], e[0]));
+    __m256d row3 = _mm256_sub_pd(_mm256_mul_pd(k[0], e[3]), _mm256_mul_pd(k[1], e[1]));
+    row3 = _mm256_add_pd(row3, _mm256_mul_pd(k[2], e[0]));
+
+    // Row i of the adjugate is column i of the cofactor matrix
+    _mm256_store_pd(&result.data[0], _mm256_mul_pd(row0, pos));
+    _mm256_store_pd(&result.data[4], _mm256_mul_pd(row1, neg));
+    _mm256_store_pd(&result.data[8], _mm256_mul_pd(row2, pos));
+    _mm256_store_pd(&result.data[12], _mm256_mul_pd(row3, neg));
+}
+#endif
+
+// Writes the adjugate of m scaled by inv_det into result; the AVX overload
+// above takes over for double where available
+template <typename T>
+static void scaled_adjugate(const SquareMatrix<4, T>& m, const SubDeterminants<T>& d,
+                            T inv_det, SquareMatrix<4, T>& result) {
+    const T* s = d.s;
+    const T* c = d.c;
+
+    result(0, 0) = ( m(1, 1) * c[5] - m(1, 2) * c[4] + m(1, 3) * c[3]) * inv_det;
+    result(0, 1) = (-m(0, 1) * c[5] + m(0, 2) * c[4] - m(0, 3) * c[3]) * inv_det;
+    result(0, 2) = ( m(3, 1) * s[5] - m(3, 2) * s[4] + m(3, 3) * s[3]) * inv_det;
+    result(0, 3) = (-m(2, 1) * s[5] + m(2, 2) * s[4] - m(2, 3) * s[3]) * inv_det;
+
+    result(1, 0) = (-m(1, 0) * c[5] + m(1, 2) * c[2] - m(1, 3) * c[1]) * inv_det;
+    result(1, 1) = ( m(0, 0) * c[5] - m(0, 2) * c[2] + m(0, 3) * c[1]) * inv_det;
+    result(1, 2) = (-m(3, 0) * s[5] + m(3, 2) * s[2] - m(3, 3) * s[1]) * inv_det;
+    result(1, 3) = ( m(2, 0) * s[5] - m(2, 2) * s[2] + m(2, 3) * s[1]) * inv_det;
+
+    result(2, 0) = ( m(1, 0) * c[4] - m(1, 1) * c[2] + m(1, 3) * c[0]) * inv_det;
+    result(2, 1) = (-m(0, 0) * c[4] + m(0, 1) * c[2] - m(0, 3) * c[0]) * inv_det;
+    result(2, 2) = ( m(3, 0) * s[4] - m(3, 1) * s[2] + m(3, 3) * s[0]) * inv_det;
+    result(2, 3) = (-m(2, 0) * s[4] + m(2, 1) * s[2] - m(2, 3) * s[0]) * inv_det;
+
+    result(3, 0) = (-m(1, 0) * c[3] + m(1, 1) * c[1] - m(1, 2) * c[0]) * inv_det;
+    result(3, 1) = ( m(0, 0) * c[3] - m(0, 1) * c[1] + m(0, 2) * c[0]) * inv_det;
+    result(3, 2) = (-m(3, 0) * s[3] + m(3, 1) * s[1] - m(3, 2) * s[0]) * inv_det;
+    result(3, 3) = ( m(2, 0) * s[3] - m(2, 1) * s[1] + m(2, 2) * s[0]) * inv_det;
+}
+
+template <typename T>
+SquareMatrix<4, T> inverse(const SquareMatrix<4, T>& m, T& det) {
+    count(Counter::Inverses);
+    SubDeterminants<T> d = sub_determinants(m);
+    det = determinant(d);
+
+    SquareMatrix<4, T> result;
+    if (std::abs(det) < Precision<T>::epsilon) {
+        // Zero matrix as error indicator
+        return result;
+    }
+    scaled_adjugate(m, d, 1 / det, result);
     return result;
 }
+
+template <typename T>
+SquareMatrix<4, T> inverse(const SquareMatrix<4, T>& m) {
+    T det;
+    return inverse(m, det);
+}
+
+#define INSTANTIATE_FIXED_MATRIX(T) \
+    template TupleT<T> multiply(const SquareMatrix<4, T>&, const TupleT<T>&); \
+    template T determinant(const SquareMatrix<4, T>&); \
+    template T determinant(const SquareMatrix<3, T>&); \
+    template T determinant(const SquareMatrix<2, T>&); \
+    template SquareMatrix<3, T> submatrix(const SquareMatrix<4, T>&, int, int); \
+    template SquareMatrix<2, T> submatrix(const SquareMatrix<3, T>&, int, int); \
+    template T minor(const SquareMatrix<4, T>&, int, int); \
+    template T minor(const SquareMatrix<3, T>&, int, int); \
+    template T cofactor(const SquareMatrix<4, T>&, int, int); \
+    template T cofactor(const SquareMatrix<3, T>&, int, int); \
+    template bool is_invertible(const SquareMatrix<4, T>&); \
+    template SquareMatrix<4, T> inverse(const SquareMatrix<4, T>&); \
+    template SquareMatrix<4, T> inverse(const SquareMatrix<4, T>&, T&); \
+    template Affine3T<T> affine_product(const Affine3T<T>&, const Affine3T<T>&);
+
+INSTANTIATE_FIXED_MATRIX(float)
+INSTANTIATE_FIXED_MATRIX(double)
+
+#undef INSTANTIATE_FIXED_MATRIX
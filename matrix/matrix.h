@@ -1,9 +1,44 @@
 #ifndef MATRIX_H
 #define MATRIX_H
 
+#include <array>
 #include <vector>
+#include "matrix/trig.h"
 #include "tuple/tuple.h"
 
+class Matrix;
+
+// Fixed-size square matrix with inline, contiguous row-major storage.
+// Unlike Matrix, creating or copying one never touches the heap, so the
+// transform math on the render hot path is allocation-free. Everything but
+// the conversion from Matrix is usable in constant expressions.
+template <int N, typename T = double>
+class SquareMatrix {
+public:
+    alignas(32) std::array<T, N * N> data;
+
+    // Zero-initialized matrix
+    constexpr SquareMatrix() : data{} {}
+
+    // Conversion from a generic matrix; only the top-left NxN block is copied
+    explicit SquareMatrix(const Matrix& m);
+
+    constexpr T& operator()(int row, int col) { return data[row * N + col]; }
+    constexpr const T& operator()(int row, int col) const { return data[row * N + col]; }
+
+    constexpr bool operator==(const SquareMatrix& other) const;
+    constexpr bool operator!=(const SquareMatrix& other) const { return !(*this == other); }
+};
+
+using Matrix4 = SquareMatrix<4>;
+using Matrix3 = SquareMatrix<3>;
+using Matrix2 = SquareMatrix<2>;
+using Matrix4f = SquareMatrix<4, float>;
+using Matrix3f = SquareMatrix<3, float>;
+using Matrix2f = SquareMatrix<2, float>;
+
+// Generic NxN matrix on the heap. It stays double precision: it is the
+// reference implementation the fixed-size types are checked against.
 class Matrix {
 public:
     int rows;
@@ -15,6 +50,16 @@ public:
     
     // Constructor for creating a matrix from initializer list
     Matrix(int rows, int cols, const std::vector<std::vector<double>>& values);
+
+    // Conversion from a fixed-size matrix
+    template <int N, typename T>
+    Matrix(const SquareMatrix<N, T>& m) : Matrix(N, N) {
+        for (int i = 0; i < N; i++) {
+            for (int j = 0; j < N; j++) {
+                data[i][j] = m(i, j);
+            }
+        }
+    }
     
     // Access element at [row, col]
     double& operator()(int row, int col);
@@ -25,11 +70,40 @@ public:
     bool operator!=(const Matrix& other) const;
 };
 
+template <int N, typename T>
+SquareMatrix<N, T>::SquareMatrix(const Matrix& m) : data{} {
+    for (int i = 0; i < N && i < m.rows; i++) {
+        for (int j = 0; j < N && j < m.cols; j++) {
+            (*this)(i, j) = static_cast<T>(m(i, j));
+        }
+    }
+}
+
+template <int N, typename T>
+constexpr bool SquareMatrix<N, T>::operator==(const SquareMatrix& other) const {
+    // Compare each element using EPSILON for floating point comparison
+    for (int i = 0; i < N * N; i++) {
+        if (absolute(data[i] - other.data[i]) >= Precision<T>::epsilon) {
+            return false;
+        }
+    }
+    return true;
+}
+
 // Factory functions for creating matrices
 Matrix matrix4x4(const std::vector<std::vector<double>>& values);
 Matrix matrix3x3(const std::vector<std::vector<double>>& values);
 Matrix matrix2x2(const std::vector<std::vector<double>>& values);
-Matrix identity_matrix();
+template <typename T = double>
+constexpr SquareMatrix<4, T> identity_matrix() {
+    // 4x4 identity matrix: 1s on diagonal, 0s elsewhere
+    SquareMatrix<4, T> result;
+    result(0, 0) = 1;
+    result(1, 1) = 1;
+    result(2, 2) = 1;
+    result(3, 3) = 1;
+    return result;
+}
 
 // matrix comparison
 bool compareMatrix(Matrix a, Matrix b); 
@@ -42,11 +116,159 @@ double minor(const Matrix& m, int row, int col);
 double cofactor(const Matrix& m, int row, int col);
 bool is_invertible(const Matrix& m);
 Matrix inverse(const Matrix& m);
-Matrix translation(double x, double y, double z);
-Matrix scaling(double x, double y, double z);
-Matrix rotation_x(double radians);
-Matrix rotation_y(double radians);
-Matrix rotation_z(double radians);
-Matrix shearing(double x_y, double x_z, double y_x, double y_z, double z_x, double z_y);
-#endif // MATRIX_H
 
+// Fixed-size overloads; same semantics as the generic versions above.
+// The ones defined here are constexpr; the rest are instantiated for float
+// and double in matrix.cpp.
+template <int N, typename T>
+constexpr bool compareMatrix(const SquareMatrix<N, T>& a, const SquareMatrix<N, T>& b) {
+    return a == b;
+}
+
+template <typename T>
+constexpr SquareMatrix<4, T> matrixMultiply(const SquareMatrix<4, T>& a, const SquareMatrix<4, T>& b) {
+    SquareMatrix<4, T> result;
+    for (int row = 0; row < 4; row++) {
+        for (int col = 0; col < 4; col++) {
+            result(row, col) = a(row, 0) * b(0, col) +
+                               a(row, 1) * b(1, col) +
+                               a(row, 2) * b(2, col) +
+                               a(row, 3) * b(3, col);
+        }
+    }
+    return result;
+}
+
+template <typename T>
+constexpr SquareMatrix<4, T> transpose(const SquareMatrix<4, T>& m) {
+    SquareMatrix<4, T> result;
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            result(j, i) = m(i, j);
+        }
+    }
+    return result;
+}
+
+template <typename T>
+TupleT<T> multiply(const SquareMatrix<4, T>& m, const TupleT<T>& t);
+template <typename T>
+T determinant(const SquareMatrix<4, T>& m);
+template <typename T>
+T determinant(const SquareMatrix<3, T>& m);
+template <typename T>
+T determinant(const SquareMatrix<2, T>& m);
+template <typename T>
+SquareMatrix<3, T> submatrix(const SquareMatrix<4, T>& m, int row, int col);
+template <typename T>
+SquareMatrix<2, T> submatrix(const SquareMatrix<3, T>& m, int row, int col);
+template <typename T>
+T minor(const SquareMatrix<4, T>& m, int row, int col);
+template <typename T>
+T minor(const SquareMatrix<3, T>& m, int row, int col);
+template <typename T>
+T cofactor(const SquareMatrix<4, T>& m, int row, int col);
+template <typename T>
+T cofactor(const SquareMatrix<3, T>& m, int row, int col);
+template <typename T>
+bool is_invertible(const SquareMatrix<4, T>& m);
+// Closed-form inverse; returns the zero matrix if m is not invertible
+template <typename T>
+SquareMatrix<4, T> inverse(const SquareMatrix<4, T>& m);
+// Same as above, also reporting the determinant so callers that need both
+// don't compute it twice
+template <typename T>
+SquareMatrix<4, T> inverse(const SquareMatrix<4, T>& m, T& det);
+
+// Transformation matrices; double unless a precision is given. With
+// constant arguments they can be evaluated at compile time.
+template <typename T = double>
+constexpr SquareMatrix<4, T> translation(NoDeduce<T> x, NoDeduce<T> y, NoDeduce<T> z) {
+    // Translation matrix: identity matrix with x, y, z in the last column
+    SquareMatrix<4, T> result = identity_matrix<T>();
+    result(0, 3) = x;
+    result(1, 3) = y;
+    result(2, 3) = z;
+    return result;
+}
+
+template <typename T = double>
+constexpr SquareMatrix<4, T> scaling(NoDeduce<T> x, NoDeduce<T> y, NoDeduce<T> z) {
+    // Scaling matrix: scaling factors on the diagonal
+    SquareMatrix<4, T> result = identity_matrix<T>();
+    result(0, 0) = x;
+    result(1, 1) = y;
+    result(2, 2) = z;
+    return result;
+}
+
+template <typename T = double>
+constexpr SquareMatrix<4, T> rotation_x(NoDeduce<T> radians) {
+    // Rotation matrix around x-axis by r radians:
+    // [1,     0,        0,     0]
+    // [0,  cos r,  -sin r,     0]
+    // [0,  sin r,   cos r,     0]
+    // [0,     0,        0,     1]
+    SquareMatrix<4, T> result = identity_matrix<T>();
+    T cos_r = static_cast<T>(cosine(radians));
+    T sin_r = static_cast<T>(sine(radians));
+    result(1, 1) = cos_r;
+    result(1, 2) = -sin_r;
+    result(2, 1) = sin_r;
+    result(2, 2) = cos_r;
+    return result;
+}
+
+template <typename T = double>
+constexpr SquareMatrix<4, T> rotation_y(NoDeduce<T> radians) {
+    // Rotation matrix around y-axis by r radians:
+    // [cos r,  0,  sin r,  0]
+    // [0,      1,  0,      0]
+    // [-sin r, 0,  cos r,  0]
+    // [0,      0,  0,      1]
+    SquareMatrix<4, T> result = identity_matrix<T>();
+    T cos_r = static_cast<T>(cosine(radians));
+    T sin_r = static_cast<T>(sine(radians));
+    result(0, 0) = cos_r;
+    result(0, 2) = sin_r;
+    result(2, 0) = -sin_r;
+    result(2, 2) = cos_r;
+    return result;
+}
+
+template <typename T = double>
+constexpr SquareMatrix<4, T> rotation_z(NoDeduce<T> radians) {
+    // Rotation matrix around z-axis by r radians:
+    // [cos r, -sin r, 0, 0]
+    // [sin r,  cos r, 0, 0]
+    // [0,      0,    1, 0]
+    // [0,      0,    0, 1]
+    SquareMatrix<4, T> result = identity_matrix<T>();
+    T cos_r = static_cast<T>(cosine(radians));
+    T sin_r = static_cast<T>(sine(radians));
+    result(0, 0) = cos_r;
+    result(0, 1) = -sin_r;
+    result(1, 0) = sin_r;
+    result(1, 1) = cos_r;
+    return result;
+}
+
+template <typename T = double>
+constexpr SquareMatrix<4, T> shearing(NoDeduce<T> x_y, NoDeduce<T> x_z, NoDeduce<T> y_x,
+                                      NoDeduce<T> y_z, NoDeduce<T> z_x, NoDeduce<T> z_y) {
+    // Shearing: one coordinate moves in proportion to another.
+    // x' = x + x_y*y + x_z*z,  y' = y_x*x + y + y_z*z,  z' = z_x*x + z_y*y + z
+    // [1,   x_y, x_z, 0]
+    // [y_x, 1,   y_z, 0]
+    // [z_x, z_y, 1,   0]
+    // [0,   0,   0,   1]
+    SquareMatrix<4, T> result = identity_matrix<T>();
+    result(0, 1) = x_y;
+    result(0, 2) = x_z;
+    result(1, 0) = y_x;
+    result(1, 2) = y_z;
+    result(2, 0) = z_x;
+    result(2, 1) = z_y;
+    return result;
+}
+#endif // MATRIX_H
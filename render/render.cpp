@@ -0,0 +1,351 @@
+#include "render.h"
+#include "arena/arena.h"
+#include "stats/stats.h"
+#include "stats/trace.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+std::vector<Tile> make_tiles(int width, int height, int tile_size) {
+    std::vector<Tile> tiles;
+    if (width <= 0 || height <= 0) {
+        return tiles;
+    }
+    tile_size = std::max(1, tile_size);
+    for (int y = 0; y < height; y += tile_size) {
+        for (int x = 0; x < width; x += tile_size) {
+            tiles.push_back({x, y, std::min(x + tile_size, width), std::min(y + tile_size, height)});
+        }
+    }
+    return tiles;
+}
+
+int worker_count(int threads) {
+    if (threads > 0) {
+        return threads;
+    }
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+namespace {
+
+// One worker's tile indices. The owner takes from the front; thieves take
+// from the back, so the two mostly work on opposite ends of the block.
+class TileQueue {
+public:
+    void push(size_t tile) {
+        tiles_.push_back(tile);
+    }
+
+    bool pop(size_t& tile) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tiles_.empty()) {
+            return false;
+        }
+        tile = tiles_.front();
+        tiles_.pop_front();
+        return true;
+    }
+
+    bool steal(size_t& tile) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tiles_.empty()) {
+            return false;
+        }
+        tile = tiles_.back();
+        tiles_.pop_back();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<size_t> tiles_;
+};
+
+} // namespace
+
+void run_tiles(const std::vector<Tile>& tiles, int threads,
+               const std::function<void(const Tile& tile, int worker)>& work) {
+    if (tiles.empty()) {
+        return;
+    }
+    int workers = static_cast<int>(std::min<size_t>(worker_count(threads), tiles.size()));
+
+    // Deal the tiles out in contiguous blocks so neighbouring tiles start on
+    // the same worker
+    std::vector<std::unique_ptr<TileQueue>> queues;
+    for (int w = 0; w < workers; w++) {
+        queues.push_back(std::make_unique<TileQueue>());
+        size_t begin = tiles.size() * w / workers;
+        size_t end = tiles.size() * (w + 1) / workers;
+        for (size_t i = begin; i < end; i++) {
+            queues[w]->push(i);
+        }
+    }
+
+    // No tiles are added once work starts, so a worker that finds its own
+    // queue and every other queue empty is done
+    auto worker_loop = [&](int worker) {
+        size_t tile;
+        for (;;) {
+            bool found = queues[worker]->pop(tile);
+            for (int i = 1; !found && i < workers; i++) {
+                found = queues[(worker + i) % workers]->steal(tile);
+            }
+            if (!found) {
+                return;
+            }
+            // Temporaries from the previous tile are dead by now
+            thread_arena().reset();
+            TraceScope trace("tile", tiles[tile].x0, tiles[tile].y0);
+            work(tiles[tile], worker);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int w = 1; w < workers; w++) {
+        pool.emplace_back(worker_loop, w);
+    }
+    worker_loop(0);
+    for (std::thread& t : pool) {
+        t.join();
+    }
+}
+
+void render(Canvas& canvas, const PixelShader& shade, const RenderOptions& options) {
+    PhaseTimer timer(Phase::Render);
+    TraceScope trace("render");
+    std::vector<Tile> tiles = make_tiles(canvas.width, canvas.height, options.tile_size);
+    run_tiles(tiles, options.threads, [&](const Tile& tile, int) {
+        // Tiles never overlap, so workers write disjoint pixels
+        for (int y = tile.y0; y < tile.y1; y++) {
+            Color* row = canvas.row(y);
+            for (int x = tile.x0; x < tile.x1; x++) {
+                row[x] = shade(x, y);
+            }
+        }
+    });
+}
+
+void render(TiledCanvas& canvas, const PixelShader& shade, const RenderOptions& options) {
+    if (!canvas.valid()) {
+        return;
+    }
+    PhaseTimer timer(Phase::Render);
+    TraceScope trace("render");
+    int size = canvas.tile_size();
+    std::vector<Tile> tiles = make_tiles(canvas.width(), canvas.height(), size);
+    run_tiles(tiles, options.threads, [&](const Tile& tile, int) {
+        Color* pixels = canvas.tile(tile.x0 / size, tile.y0 / size);
+        for (int y = tile.y0; y < tile.y1; y++) {
+            Color* row = pixels + static_cast<size_t>(y - tile.y0) * size;
+            for (int x = tile.x0; x < tile.x1; x++) {
+                row[x - tile.x0] = shade(x, y);
+            }
+        }
+    });
+}
+
+// Element i of the van der Corput sequence in the given base; bases 2 and 3
+// together give the Halton points used as sub-pixel offsets
+static double radical_inverse(int i, int base) {
+    double result = 0.0;
+    double scale = 1.0 / base;
+    for (; i > 0; i /= base) {
+        result += (i % base) * scale;
+        scale /= base;
+    }
+    return result;
+}
+
+// First multiple of step at or after value
+static int align_up(int value, int step) {
+    return (value + step - 1) / step * step;
+}
+
+void render_progressive(Canvas& canvas, const PixelShader& shade,
+                        const ProgressiveOptions& options, const PassCallback& on_pass) {
+    PhaseTimer timer(Phase::Render);
+    TraceScope trace("render progressive");
+    std::vector<Tile> tiles = make_tiles(canvas.width, canvas.height, options.tile_size);
+    int pass = 0;
+
+    int step = 1;
+    while (step * 2 <= options.initial_step) {
+        step *= 2;
+    }
+
+    // Refinement: a pass at spacing `step` shades the lattice points not
+    // shaded by earlier passes and fills the step x step block below and to
+    // the right of each. Blocks within a pass are disjoint, so tiles never
+    // write the same pixel even when a block crosses a tile edge.
+    for (bool coarse = true; step >= 1; step /= 2, coarse = false) {
+        run_tiles(tiles, options.threads, [&](const Tile& tile, int) {
+            for (int y = align_up(tile.y0, step); y < tile.y1; y += step) {
+                for (int x = align_up(tile.x0, step); x < tile.x1; x += step) {
+                    if (!coarse && x % (2 * step) == 0 && y % (2 * step) == 0) {
+                        continue;
+                    }
+                    Color c = shade(x, y);
+                    int y_end = std::min(y + step, canvas.height);
+                    int x_end = std::min(x + step, canvas.width);
+                    for (int by = y; by < y_end; by++) {
+                        std::fill(canvas.row(by) + x, canvas.row(by) + x_end, c);
+                    }
+                }
+            }
+        });
+        RenderPass done = {pass++, step, step == 1 ? 1 : 0};
+        if (on_pass && !on_pass(canvas, done)) {
+            return;
+        }
+    }
+
+    if (options.samples_per_pixel <= 1) {
+        return;
+    }
+
+    // Supersampling: keep running sums and show their mean after each pass
+    std::vector<Color> sums(canvas.pixels);
+    for (int sample = 1; sample < options.samples_per_pixel; sample++) {
+        double dx = radical_inverse(sample, 2);
+        double dy = radical_inverse(sample, 3);
+        double scale = 1.0 / (sample + 1);
+        run_tiles(tiles, options.threads, [&](const Tile& tile, int) {
+            for (int y = tile.y0; y < tile.y1; y++) {
+                Color* sum = sums.data() + y * canvas.stride();
+                Color* row = canvas.row(y);
+                for (int x = tile.x0; x < tile.x1; x++) {
+                    Color c = shade(x + dx, y + dy);
+                    sum[x] = Color(sum[x].red() + c.red(), sum[x].green() + c.green(),
+                                   sum[x].blue() + c.blue());
+                    row[x] = Color(sum[x].red() * scale, sum[x].green() * scale,
+                                   sum[x].blue() * scale);
+                }
+            }
+        });
+        RenderPass done = {pass++, 1, sample + 1};
+        if (on_pass && !on_pass(canvas, done)) {
+            return;
+        }
+    }
+}
+
+// Cells (column, row) of the 4 x 4 sample grid in the order they are
+// taken. The first is nearest the pixel centre. Each batch of four is a
+// rook pattern, one sample in every row, column and quadrant, so the
+// first batch already sees an edge crossing the pixel in any direction.
+static const int SAMPLE_CELLS[ADAPTIVE_MAX_SAMPLES][2] = {
+    {2, 2}, {0, 1}, {1, 3}, {3, 0},
+    {0, 3}, {1, 0}, {2, 1}, {3, 2},
+    {0, 0}, {1, 2}, {2, 3}, {3, 1},
+    {0, 2}, {1, 1}, {2, 0}, {3, 3},
+};
+
+// Samples a refined pixel takes before it may stop: one batch that agrees
+// with itself can still miss an edge clipping a corner of the pixel
+static const int MIN_REFINED_SAMPLES = 8;
+
+// Offset of grid cell i within the pixel
+static double cell_offset(int i) {
+    return (i + 0.5) / 4;
+}
+
+static double max_difference(const Color& a, const Color& b) {
+    return std::max(std::abs(a.red() - b.red()),
+                    std::max(std::abs(a.green() - b.green()), std::abs(a.blue() - b.blue())));
+}
+
+// True if pixel (x, y) of the first-sample image differs from a neighbour
+// by more than threshold
+static bool needs_refinement(const Canvas& first, int x, int y, double threshold) {
+    const Color& center = first.row(y)[x];
+    for (int ny = std::max(0, y - 1); ny <= std::min(first.height - 1, y + 1); ny++) {
+        const Color* row = first.row(ny);
+        for (int nx = std::max(0, x - 1); nx <= std::min(first.width - 1, x + 1); nx++) {
+            if (max_difference(center, row[nx]) > threshold) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+SamplingReport render_adaptive(Canvas& canvas, const PixelShader& shade,
+                               const AdaptiveOptions& options) {
+    PhaseTimer timer(Phase::Render);
+    TraceScope trace("render adaptive");
+    std::vector<Tile> tiles = make_tiles(canvas.width, canvas.height, options.tile_size);
+    int max_samples = std::max(1, std::min(options.max_samples, ADAPTIVE_MAX_SAMPLES));
+
+    SamplingReport report;
+    report.pixels = static_cast<long long>(canvas.width) * canvas.height;
+    report.samples = report.pixels;
+
+    // One sample everywhere
+    double first_x = cell_offset(SAMPLE_CELLS[0][0]);
+    double first_y = cell_offset(SAMPLE_CELLS[0][1]);
+    run_tiles(tiles, options.threads, [&](const Tile& tile, int) {
+        for (int y = tile.y0; y < tile.y1; y++) {
+            Color* row = canvas.row(y);
+            for (int x = tile.x0; x < tile.x1; x++) {
+                row[x] = shade(x + first_x, y + first_y);
+            }
+        }
+    });
+    if (max_samples == 1) {
+        return report;
+    }
+
+    // Refinement reads the neighbours' first samples from a copy, since
+    // tiles overwrite the canvas as they go
+    Canvas first = canvas;
+    std::vector<SamplingReport> spent(static_cast<size_t>(worker_count(options.threads)));
+    run_tiles(tiles, options.threads, [&](const Tile& tile, int worker) {
+        for (int y = tile.y0; y < tile.y1; y++) {
+            Color* row = canvas.row(y);
+            for (int x = tile.x0; x < tile.x1; x++) {
+                if (!needs_refinement(first, x, y, options.threshold)) {
+                    continue;
+                }
+                // Running sums and sums of squares of each component
+                const Color& c0 = first.row(y)[x];
+                double sum[3] = {c0.red(), c0.green(), c0.blue()};
+                double squares[3] = {sum[0] * sum[0], sum[1] * sum[1], sum[2] * sum[2]};
+                int n = 1;
+                while (n < max_samples) {
+                    int batch_end = std::min(max_samples, n < 4 ? 4 : n + 4);
+                    for (; n < batch_end; n++) {
+                        Color c = shade(x + cell_offset(SAMPLE_CELLS[n][0]),
+                                        y + cell_offset(SAMPLE_CELLS[n][1]));
+                        double components[3] = {c.red(), c.green(), c.blue()};
+                        for (int k = 0; k < 3; k++) {
+                            sum[k] += components[k];
+                            squares[k] += components[k] * components[k];
+                        }
+                    }
+                    // Stop once the mean is known to within the threshold
+                    double variance = 0.0;
+                    for (int k = 0; k < 3; k++) {
+                        variance = std::max(variance, (squares[k] - sum[k] * sum[k] / n) / (n - 1));
+                    }
+                    if (n >= MIN_REFINED_SAMPLES && std::sqrt(std::max(variance, 0.0) / n) <= options.threshold) {
+                        break;
+                    }
+                }
+                row[x] = Color(sum[0] / n, sum[1] / n, sum[2] / n);
+                spent[worker].samples += n - 1;
+                spent[worker].refined_pixels++;
+            }
+        }
+    });
+    for (const SamplingReport& s : spent) {
+        report.samples += s.samples;
+        report.refined_pixels += s.refined_pixels;
+    }
+    return report;
+}
+
@@ -0,0 +1,121 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "canvas/tiled_canvas.h"
+#include "tuple/tuple.h"
+#include <functional>
+#include <vector>
+
+// Computes the color seen through image-plane position (x, y), in pixel
+// units: pixel (x, y) covers [x, x+1) x [y, y+1). Called concurrently from
+// several threads, so it must not modify shared state. Temporaries may be
+// allocated from thread_arena(), which is reset between tiles.
+using PixelShader = std::function<Color(double x, double y)>;
+
+struct RenderOptions {
+    // Worker threads; 0 uses every hardware thread
+    int threads = 0;
+    // Edge length of the square tiles the canvas is split into
+    int tile_size = 16;
+};
+
+// Half-open pixel rectangle [x0, x1) x [y0, y1)
+struct Tile {
+    int x0, y0;
+    int x1, y1;
+};
+
+// Splits a width x height image into row-major tiles of at most
+// tile_size x tile_size pixels
+std::vector<Tile> make_tiles(int width, int height, int tile_size);
+
+// Number of workers `threads` resolves to (0 = hardware concurrency)
+int worker_count(int threads);
+
+// Calls work(tile, worker) once for every tile on `threads` workers (the
+// calling thread is worker 0). Tiles are dealt out in contiguous blocks;
+// a worker that runs out steals from the far end of another's queue, so
+// tiles of uneven cost still balance. Each worker resets its
+// thread_arena() before every tile.
+void run_tiles(const std::vector<Tile>& tiles, int threads,
+               const std::function<void(const Tile& tile, int worker)>& work);
+
+// Renders every pixel of the canvas by sampling shade at the pixel's
+// top-left corner (x, y). Each pixel depends only on shade, so the result
+// is identical for any thread count.
+void render(Canvas& canvas, const PixelShader& shade,
+            const RenderOptions& options = RenderOptions());
+// Same, for a file-backed canvas. Work is split along the canvas's own
+// tiles (options.tile_size is ignored) so each task writes one contiguous
+// block of the mapping.
+void render(TiledCanvas& canvas, const PixelShader& shade,
+            const RenderOptions& options = RenderOptions());
+
+struct ProgressiveOptions : RenderOptions {
+    // Pixel spacing of the first, coarse pass; rounded down to a power of
+    // two. Each later pass halves it until every pixel has one sample.
+    int initial_step = 8;
+    // Samples per pixel to reach; passes beyond the first sample each add
+    // one sample to every pixel at a new sub-pixel offset
+    int samples_per_pixel = 1;
+};
+
+// A finished progressive pass, as reported to the callback
+struct RenderPass {
+    // 0 for the coarse pass
+    int index;
+    // Spacing of the pixels sampled so far; 1 once every pixel is sampled
+    int step;
+    // Samples every pixel has so far; 0 while step > 1
+    int samples;
+};
+
+// Sees the canvas after each pass; return false to stop refining
+using PassCallback = std::function<bool(const Canvas& canvas, const RenderPass& pass)>;
+
+// Renders in passes of increasing quality so a preview is available early.
+// The first pass shades every initial_step-th pixel in each direction and
+// fills the block it covers; each later pass shades the pixels halfway
+// between the previous ones, until every pixel has been shaded at its
+// corner (the same image render() produces). Further passes average in one
+// more sample per pixel at a time up to samples_per_pixel. on_pass, if set,
+// runs on the calling thread after every pass.
+void render_progressive(Canvas& canvas, const PixelShader& shade,
+                        const ProgressiveOptions& options = ProgressiveOptions(),
+                        const PassCallback& on_pass = PassCallback());
+
+// Samples of the grid adaptive rendering draws from (4 x 4 per pixel)
+constexpr int ADAPTIVE_MAX_SAMPLES = 16;
+
+struct AdaptiveOptions : RenderOptions {
+    // Most samples a pixel can receive, up to ADAPTIVE_MAX_SAMPLES
+    int max_samples = 16;
+    // Largest component difference tolerated between neighbouring pixels,
+    // and the standard error at which a refined pixel's mean is accepted
+    double threshold = 0.02;
+};
+
+// Work done by an adaptive render
+struct SamplingReport {
+    long long pixels = 0;
+    long long samples = 0;
+    // Pixels that received more than the first sample
+    long long refined_pixels = 0;
+
+    double samples_per_pixel() const {
+        return pixels > 0 ? static_cast<double>(samples) / pixels : 0.0;
+    }
+};
+
+// Anti-aliased rendering that spends samples only where the image needs
+// them. Every pixel first gets one sample; a pixel differing from any of
+// its eight neighbours by more than threshold is then refined in batches
+// of four samples (at least eight in all), stopping once the standard
+// error of its mean is within threshold or max_samples is reached.
+// Samples lie on a stratified 4 x 4 grid, so a fully refined pixel equals
+// 16x supersampling on that grid, while flat regions cost one sample. The
+// result is identical for any thread count.
+SamplingReport render_adaptive(Canvas& canvas, const PixelShader& shade,
+                               const AdaptiveOptions& options = AdaptiveOptions());
+
+#endif // RENDER_H
@@ -0,0 +1,326 @@
+#include "bvh.h"
+#include "stats/stats.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Builder tuning: SAH candidates per axis, and the leaf size below which
+// splitting is never attempted. Four spheres fill one AVX pass of the leaf
+// kernel.
+static const int BIN_COUNT = 12;
+static const size_t MIN_SPLIT_SIZE = 4;
+static const size_t MAX_LEAF_SIZE = 16;
+// Relative cost of visiting a node compared with testing one sphere
+static const double TRAVERSAL_COST = 1.0;
+// Below this depth SAH splits give way to median splits, which halve the
+// count each level; that caps the tree depth for any 32-bit sphere count
+// and lets traversal use a fixed stack
+static const int MAX_SAH_DEPTH = 64;
+static const int MAX_TRAVERSAL_DEPTH = MAX_SAH_DEPTH + 32 + 1;
+
+Bounds bounds(const Sphere& s) {
+    // Each world axis of the ellipsoid extends radius * |row i of the linear
+    // part| either side of the transformed center
+    const Matrix4& m = s.transform();
+    Tuple center = multiply(m, s.origin);
+    double c[3] = {center.x, center.y, center.z};
+    Bounds b;
+    for (int i = 0; i < 3; i++) {
+        double extent = s.radius * std::sqrt(m(i, 0) * m(i, 0) + m(i, 1) * m(i, 1) + m(i, 2) * m(i, 2));
+        b.min[i] = c[i] - extent;
+        b.max[i] = c[i] + extent;
+    }
+    return b;
+}
+
+static Bounds empty_bounds() {
+    Bounds b;
+    for (int i = 0; i < 3; i++) {
+        b.min[i] = std::numeric_limits<double>::infinity();
+        b.max[i] = -std::numeric_limits<double>::infinity();
+    }
+    return b;
+}
+
+static void grow(Bounds& b, const Bounds& other) {
+    for (int i = 0; i < 3; i++) {
+        b.min[i] = std::min(b.min[i], other.min[i]);
+        b.max[i] = std::max(b.max[i], other.max[i]);
+    }
+}
+
+static void grow(Bounds& b, const double p[3]) {
+    for (int i = 0; i < 3; i++) {
+        b.min[i] = std::min(b.min[i], p[i]);
+        b.max[i] = std::max(b.max[i], p[i]);
+    }
+}
+
+static double surface_area(const Bounds& b) {
+    double dx = b.max[0] - b.min[0];
+    double dy = b.max[1] - b.min[1];
+    double dz = b.max[2] - b.min[2];
+    if (dx < 0 || dy < 0 || dz < 0) {
+        return 0.0;
+    }
+    return 2.0 * (dx * dy + dy * dz + dz * dx);
+}
+
+namespace {
+
+// A sphere's box and centroid while the hierarchy is being built
+struct BuildItem {
+    Bounds box;
+    double centroid[3];
+    size_t source;
+};
+
+struct Builder {
+    std::vector<BuildItem> items;
+    std::vector<BvhNode> nodes;
+
+    // Builds the subtree over items [begin, end) and returns its node index
+    uint32_t build(size_t begin, size_t end, int depth) {
+        uint32_t index = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(BvhNode());
+
+        Bounds box = empty_bounds();
+        Bounds centroids = empty_bounds();
+        for (size_t i = begin; i < end; i++) {
+            grow(box, items[i].box);
+            grow(centroids, items[i].centroid);
+        }
+        nodes[index].box = box;
+
+        size_t count = end - begin;
+        size_t mid = begin;
+        if (count > MIN_SPLIT_SIZE) {
+            mid = depth < MAX_SAH_DEPTH ? split(begin, end, box, centroids)
+                                        : median_split(begin, end, widest_axis(centroids));
+        }
+        if (mid == begin) {
+            nodes[index].offset = static_cast<uint32_t>(begin);
+            nodes[index].count = static_cast<uint16_t>(count);
+            nodes[index].axis = 0;
+            return index;
+        }
+
+        nodes[index].count = 0;
+        nodes[index].axis = static_cast<uint16_t>(widest_axis(centroids));
+        build(begin, mid, depth + 1);
+        uint32_t second = build(mid, end, depth + 1);
+        nodes[index].offset = second;
+        return index;
+    }
+
+    static int widest_axis(const Bounds& b) {
+        int axis = 0;
+        for (int i = 1; i < 3; i++) {
+            if (b.max[i] - b.min[i] > b.max[axis] - b.min[axis]) {
+                axis = i;
+            }
+        }
+        return axis;
+    }
+
+    // Partitions [begin, end) at the cheapest binned SAH plane along the
+    // widest centroid axis and returns the split point, or begin if a leaf
+    // is cheaper
+    size_t split(size_t begin, size_t end, const Bounds& box, const Bounds& centroids) {
+        size_t count = end - begin;
+        int axis = widest_axis(centroids);
+        double lo = centroids.min[axis];
+        double extent = centroids.max[axis] - lo;
+
+        if (extent <= 0.0) {
+            // Every centroid coincides; no plane separates them
+            return count > MAX_LEAF_SIZE ? median_split(begin, end, axis) : begin;
+        }
+
+        struct Bin {
+            Bounds box = empty_bounds();
+            size_t count = 0;
+        };
+        Bin bins[BIN_COUNT];
+        double scale = BIN_COUNT / extent;
+        auto bin_of = [&](const BuildItem& item) {
+            int b = static_cast<int>((item.centroid[axis] - lo) * scale);
+            return std::min(b, BIN_COUNT - 1);
+        };
+        for (size_t i = begin; i < end; i++) {
+            Bin& bin = bins[bin_of(items[i])];
+            grow(bin.box, items[i].box);
+            bin.count++;
+        }
+
+        // Sweep from the right to get the cost of everything past each plane,
+        // then from the left to evaluate the planes
+        double right_area[BIN_COUNT];
+        size_t right_count[BIN_COUNT];
+        Bounds right = empty_bounds();
+        size_t right_total = 0;
+        for (int b = BIN_COUNT - 1; b > 0; b--) {
+            grow(right, bins[b].box);
+            right_total += bins[b].count;
+            right_area[b] = surface_area(right);
+            right_count[b] = right_total;
+        }
+
+        double best_cost = std::numeric_limits<double>::infinity();
+        int best_plane = 0;
+        Bounds left = empty_bounds();
+        size_t left_total = 0;
+        for (int b = 1; b < BIN_COUNT; b++) {
+            grow(left, bins[b - 1].box);
+            left_total += bins[b - 1].count;
+            if (left_total == 0 || right_count[b] == 0) {
+                continue;
+            }
+            double cost = surface_area(left) * left_total + right_area[b] * right_count[b];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_plane = b;
+            }
+        }
+
+        double area = surface_area(box);
+        double leaf_cost = area * count;
+        double split_cost = area * TRAVERSAL_COST + best_cost;
+        if (best_plane == 0 || (split_cost >= leaf_cost && count <= MAX_LEAF_SIZE)) {
+            return count > MAX_LEAF_SIZE ? median_split(begin, end, axis) : begin;
+        }
+
+        auto first_right = std::partition(items.begin() + begin, items.begin() + end,
+            [&](const BuildItem& item) { return bin_of(item) < best_plane; });
+        return static_cast<size_t>(first_right - items.begin());
+    }
+
+    // Splits [begin, end) into halves by centroid along axis
+    size_t median_split(size_t begin, size_t end, int axis) {
+        size_t mid = begin + (end - begin) / 2;
+        std::nth_element(items.begin() + begin, items.begin() + mid, items.begin() + end,
+            [axis](const BuildItem& a, const BuildItem& b) { return a.centroid[axis] < b.centroid[axis]; });
+        return mid;
+    }
+};
+
+} // namespace
+
+Bvh::Bvh(const std::vector<Sphere>& spheres) {
+    if (spheres.empty()) {
+        return;
+    }
+
+    Builder builder;
+    builder.items.reserve(spheres.size());
+    for (size_t i = 0; i < spheres.size(); i++) {
+        BuildItem item;
+        item.box = bounds(spheres[i]);
+        for (int k = 0; k < 3; k++) {
+            item.centroid[k] = 0.5 * (item.box.min[k] + item.box.max[k]);
+        }
+        item.source = i;
+        builder.items.push_back(item);
+    }
+    builder.nodes.reserve(2 * spheres.size() / MIN_SPLIT_SIZE + 1);
+    builder.build(0, spheres.size(), 0);
+
+    nodes_ = std::move(builder.nodes);
+    spheres_.reserve(spheres.size());
+    source_index_.reserve(spheres.size());
+    for (const BuildItem& item : builder.items) {
+        spheres_.add(spheres[item.source]);
+        source_index_.push_back(item.source);
+    }
+}
+
+// Slab test: does the ray enter the box somewhere in [t_min, t_max]?
+static bool hits_box(const Bounds& b, const double origin[3], const double inv_dir[3],
+                     double t_min, double t_max) {
+    for (int i = 0; i < 3; i++) {
+        double t0 = (b.min[i] - origin[i]) * inv_dir[i];
+        double t1 = (b.max[i] - origin[i]) * inv_dir[i];
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+        t_min = t0 > t_min ? t0 : t_min;
+        t_max = t1 < t_max ? t1 : t_max;
+        if (t_min > t_max) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Walks the hierarchy near-to-far for the leaves whose boxes the ray enters
+// within [t_min, t_max], calling visit(leaf) on each. visit may lower t_max
+// to cull the rest, and returns true to stop the walk early.
+template <typename Visit>
+static void traverse(const std::vector<BvhNode>& nodes, const Ray& ray,
+                     double t_min, const double& t_max, Visit visit) {
+    if (nodes.empty()) {
+        return;
+    }
+    const double origin[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+    const double inv_dir[3] = {1.0 / ray.direction.x, 1.0 / ray.direction.y, 1.0 / ray.direction.z};
+    const bool negative[3] = {inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0};
+
+    uint32_t stack[MAX_TRAVERSAL_DEPTH];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const BvhNode& node = nodes[stack[--top]];
+        if (!hits_box(node.box, origin, inv_dir, t_min, t_max)) {
+            continue;
+        }
+        if (node.count > 0) {
+            if (visit(node)) {
+                return;
+            }
+            continue;
+        }
+        // Push the farther child first so the nearer one is visited next
+        uint32_t first = static_cast<uint32_t>(&node - nodes.data()) + 1;
+        uint32_t second = node.offset;
+        if (negative[node.axis]) {
+            std::swap(first, second);
+        }
+        stack[top++] = second;
+        stack[top++] = first;
+    }
+}
+
+bool nearest_hit(const Bvh& bvh, const Ray& ray, double t_min, double& t_max, size_t& index) {
+    bool found = false;
+    // t_max shrinks with every hit, culling boxes behind it
+    traverse(bvh.nodes_, ray, t_min, t_max, [&](const BvhNode& leaf) {
+        found |= nearest_hit(bvh.spheres_, ray, leaf.offset, leaf.offset + leaf.count,
+                             t_min, t_max, index);
+        return false;
+    });
+    return found;
+}
+
+bool any_hit(const Bvh& bvh, const Ray& ray, double t_min, double t_max) {
+    bool found = false;
+    traverse(bvh.nodes_, ray, t_min, t_max, [&](const BvhNode& leaf) {
+        double t = t_max;
+        size_t index;
+        found = nearest_hit(bvh.spheres_, ray, leaf.offset, leaf.offset + leaf.count,
+                            t_min, t, index);
+        return found;
+    });
+    return found;
+}
+
+std::optional<Intersection> hit(const Bvh& bvh, const Ray& ray) {
+    count(Counter::Rays);
+    double t = std::numeric_limits<double>::infinity();
+    size_t index;
+    if (!nearest_hit(bvh, ray, 0.0, t, index)) {
+        return std::nullopt;
+    }
+    count(Counter::Hits);
+    return intersection(t, bvh[index]);
+}
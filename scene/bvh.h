@@ -0,0 +1,68 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "ray/ray.h"
+#include "scene/sphere_set.h"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Axis-aligned box [min, max] in world space
+struct Bounds {
+    double min[3];
+    double max[3];
+};
+
+// The tight world-space box around a sphere, i.e. around the ellipsoid its
+// transform turns it into
+Bounds bounds(const Sphere& s);
+
+// One node of the flattened hierarchy, in depth-first order. An interior
+// node's first child directly follows it and `offset` is the index of its
+// second child; a leaf covers spheres [offset, offset + count).
+struct BvhNode {
+    Bounds box;
+    uint32_t offset;
+    uint16_t count;  // 0 for interior nodes
+    uint16_t axis;   // split axis, used to visit the nearer child first
+};
+
+// Bounding volume hierarchy over a fixed list of spheres, built with a
+// binned surface area heuristic. The spheres are copied into leaf order so
+// each leaf is a contiguous run of a SphereSet.
+class Bvh {
+public:
+    Bvh() = default;
+    explicit Bvh(const std::vector<Sphere>& spheres);
+
+    size_t size() const { return spheres_.size(); }
+    // Spheres are numbered in leaf order
+    const Sphere& operator[](size_t i) const { return spheres_[i]; }
+    // Position of sphere i in the vector the hierarchy was built from
+    size_t source_index(size_t i) const { return source_index_[i]; }
+    const std::vector<BvhNode>& nodes() const { return nodes_; }
+
+    friend bool nearest_hit(const Bvh& bvh, const Ray& ray,
+                            double t_min, double& t_max, size_t& index);
+    friend bool any_hit(const Bvh& bvh, const Ray& ray, double t_min, double t_max);
+
+private:
+    std::vector<BvhNode> nodes_;
+    SphereSet spheres_;
+    std::vector<size_t> source_index_;
+};
+
+// Same contract as nearest_hit() on a SphereSet, over every sphere in the
+// hierarchy; index is in leaf order
+bool nearest_hit(const Bvh& bvh, const Ray& ray, double t_min, double& t_max, size_t& index);
+
+// True if any sphere is hit with t_min <= t < t_max; stops at the first
+// leaf that has one, so it suits shadow and visibility rays
+bool any_hit(const Bvh& bvh, const Ray& ray, double t_min, double t_max);
+
+// The hit (lowest nonnegative t) of ray against the hierarchy. The
+// intersection points into the hierarchy, so it is valid while it lives.
+std::optional<Intersection> hit(const Bvh& bvh, const Ray& ray);
+
+#endif // BVH_H
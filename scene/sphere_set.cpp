@@ -0,0 +1,243 @@
+#include "sphere_set.h"
+#include "tuple/simd.h"
+#include "stats/stats.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void SphereSet::add(const Sphere& s) {
+    const Matrix4& inv = s.inverse_transform();
+    double origin[3] = {s.origin.x, s.origin.y, s.origin.z};
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            m_[r][c].push_back(inv(r, c));
+        }
+        m_[r][3].push_back(inv(r, 3) - origin[r]);
+    }
+    radius2_.push_back(s.radius * s.radius);
+    spheres_.push_back(s);
+}
+
+void SphereSet::reserve(size_t count) {
+    for (auto& row : m_) {
+        for (auto& column : row) {
+            column.reserve(count);
+        }
+    }
+    radius2_.reserve(count);
+    spheres_.reserve(count);
+}
+
+void SphereSet::clear() {
+    for (auto& row : m_) {
+        for (auto& column : row) {
+            column.clear();
+        }
+    }
+    radius2_.clear();
+    spheres_.clear();
+}
+
+#if defined(RT_SIMD_SSE2)
+// mask ? a : b, without SSE4.1's blendv
+static __m128d select(__m128d mask, __m128d a, __m128d b) {
+    return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+#endif
+
+bool nearest_hit(const SphereSet& set, const Ray& ray, size_t begin, size_t end,
+                 double t_min, double& t_max, size_t& index) {
+    count(Counter::ShapeTests, end - begin);
+    const double o[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+    const double d[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+    double best = t_max;
+    size_t best_index = end;
+    size_t i = begin;
+
+#if defined(RT_SIMD_AVX)
+    // Four spheres per iteration; the ray is broadcast to every lane
+    __m256d bo[3], bd[3];
+    for (int k = 0; k < 3; k++) {
+        bo[k] = _mm256_set1_pd(o[k]);
+        bd[k] = _mm256_set1_pd(d[k]);
+    }
+    const __m256d lo = _mm256_set1_pd(t_min);
+    __m256d lane_best = _mm256_set1_pd(t_max);
+    __m256d lane_index = _mm256_set1_pd(-1.0);
+
+    for (; i + 4 <= end; i += 4) {
+        __m256d s[3], v[3];
+        for (int r = 0; r < 3; r++) {
+            __m256d m0 = _mm256_loadu_pd(&set.m_[r][0][i]);
+            __m256d m1 = _mm256_loadu_pd(&set.m_[r][1][i]);
+            __m256d m2 = _mm256_loadu_pd(&set.m_[r][2][i]);
+            __m256d m3 = _mm256_loadu_pd(&set.m_[r][3][i]);
+            __m256d linear_o = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m0, bo[0]), _mm256_mul_pd(m1, bo[1])),
+                                             _mm256_mul_pd(m2, bo[2]));
+            s[r] = _mm256_add_pd(linear_o, m3);
+            v[r] = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m0, bd[0]), _mm256_mul_pd(m1, bd[1])),
+                                 _mm256_mul_pd(m2, bd[2]));
+        }
+        __m256d a = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(v[0], v[0]), _mm256_mul_pd(v[1], v[1])),
+                                  _mm256_mul_pd(v[2], v[2]));
+        __m256d half_b = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(v[0], s[0]), _mm256_mul_pd(v[1], s[1])),
+                                       _mm256_mul_pd(v[2], s[2]));
+        __m256d b = _mm256_add_pd(half_b, half_b);
+        __m256d c = _mm256_sub_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(s[0], s[0]), _mm256_mul_pd(s[1], s[1])),
+                                                _mm256_mul_pd(s[2], s[2])),
+                                  _mm256_loadu_pd(&set.radius2_[i]));
+        __m256d disc = _mm256_sub_pd(_mm256_mul_pd(b, b), _mm256_mul_pd(_mm256_set1_pd(4.0), _mm256_mul_pd(a, c)));
+        __m256d has_roots = _mm256_cmp_pd(disc, _mm256_setzero_pd(), _CMP_GE_OQ);
+        if (_mm256_movemask_pd(has_roots) == 0) {
+            // Most groups miss; skip the square root and divides like the scalar loop
+            continue;
+        }
+        __m256d sqrt_disc = _mm256_sqrt_pd(_mm256_max_pd(disc, _mm256_setzero_pd()));
+        __m256d two_a = _mm256_add_pd(a, a);
+        __m256d neg_b = _mm256_sub_pd(_mm256_setzero_pd(), b);
+        __m256d t1 = _mm256_div_pd(_mm256_sub_pd(neg_b, sqrt_disc), two_a);
+        __m256d t2 = _mm256_div_pd(_mm256_add_pd(neg_b, sqrt_disc), two_a);
+
+        // Nearer root if it is in range, else the farther one
+        __m256d t = _mm256_blendv_pd(t2, t1, _mm256_cmp_pd(t1, lo, _CMP_GE_OQ));
+        __m256d usable = _mm256_and_pd(has_roots, _mm256_cmp_pd(t, lo, _CMP_GE_OQ));
+        __m256d closer = _mm256_and_pd(usable, _mm256_cmp_pd(t, lane_best, _CMP_LT_OQ));
+        lane_best = _mm256_blendv_pd(lane_best, t, closer);
+        __m256d ids = _mm256_setr_pd(double(i), double(i + 1), double(i + 2), double(i + 3));
+        lane_index = _mm256_blendv_pd(lane_index, ids, closer);
+    }
+
+    alignas(32) double ts[4];
+    alignas(32) double ids[4];
+    _mm256_store_pd(ts, lane_best);
+    _mm256_store_pd(ids, lane_index);
+    for (int lane = 0; lane < 4; lane++) {
+        // Ties go to the lower index, matching the scalar order
+        size_t id = static_cast<size_t>(ids[lane]);
+        if (ids[lane] >= 0 && (ts[lane] < best || (ts[lane] == best && id < best_index))) {
+            best = ts[lane];
+            best_index = id;
+        }
+    }
+#elif defined(RT_SIMD_SSE2)
+    // Same kernel as the AVX version, two spheres per iteration
+    __m128d bo[3], bd[3];
+    for (int k = 0; k < 3; k++) {
+        bo[k] = _mm_set1_pd(o[k]);
+        bd[k] = _mm_set1_pd(d[k]);
+    }
+    const __m128d lo = _mm_set1_pd(t_min);
+    __m128d lane_best = _mm_set1_pd(t_max);
+    __m128d lane_index = _mm_set1_pd(-1.0);
+
+    for (; i + 2 <= end; i += 2) {
+        __m128d s[3], v[3];
+        for (int r = 0; r < 3; r++) {
+            __m128d m0 = _mm_loadu_pd(&set.m_[r][0][i]);
+            __m128d m1 = _mm_loadu_pd(&set.m_[r][1][i]);
+            __m128d m2 = _mm_loadu_pd(&set.m_[r][2][i]);
+            __m128d m3 = _mm_loadu_pd(&set.m_[r][3][i]);
+            __m128d linear_o = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m0, bo[0]), _mm_mul_pd(m1, bo[1])),
+                                          _mm_mul_pd(m2, bo[2]));
+            s[r] = _mm_add_pd(linear_o, m3);
+            v[r] = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m0, bd[0]), _mm_mul_pd(m1, bd[1])),
+                              _mm_mul_pd(m2, bd[2]));
+        }
+        __m128d a = _mm_add_pd(_mm_add_pd(_mm_mul_pd(v[0], v[0]), _mm_mul_pd(v[1], v[1])),
+                               _mm_mul_pd(v[2], v[2]));
+        __m128d half_b = _mm_add_pd(_mm_add_pd(_mm_mul_pd(v[0], s[0]), _mm_mul_pd(v[1], s[1])),
+                                    _mm_mul_pd(v[2], s[2]));
+        __m128d b = _mm_add_pd(half_b, half_b);
+        __m128d c = _mm_sub_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(s[0], s[0]), _mm_mul_pd(s[1], s[1])),
+                                          _mm_mul_pd(s[2], s[2])),
+                               _mm_loadu_pd(&set.radius2_[i]));
+        __m128d disc = _mm_sub_pd(_mm_mul_pd(b, b), _mm_mul_pd(_mm_set1_pd(4.0), _mm_mul_pd(a, c)));
+        __m128d has_roots = _mm_cmpge_pd(disc, _mm_setzero_pd());
+        if (_mm_movemask_pd(has_roots) == 0) {
+            // Most pairs miss; skip the square root and divides like the scalar loop
+            continue;
+        }
+        __m128d sqrt_disc = _mm_sqrt_pd(_mm_max_pd(disc, _mm_setzero_pd()));
+        __m128d two_a = _mm_add_pd(a, a);
+        __m128d neg_b = _mm_sub_pd(_mm_setzero_pd(), b);
+        __m128d t1 = _mm_div_pd(_mm_sub_pd(neg_b, sqrt_disc), two_a);
+        __m128d t2 = _mm_div_pd(_mm_add_pd(neg_b, sqrt_disc), two_a);
+
+        // Nearer root if it is in range, else the farther one
+        __m128d t = select(_mm_cmpge_pd(t1, lo), t1, t2);
+        __m128d usable = _mm_and_pd(has_roots, _mm_cmpge_pd(t, lo));
+        __m128d closer = _mm_and_pd(usable, _mm_cmplt_pd(t, lane_best));
+        lane_best = select(closer, t, lane_best);
+        __m128d ids = _mm_setr_pd(double(i), double(i + 1));
+        lane_index = select(closer, ids, lane_index);
+    }
+
+    alignas(16) double ts[2];
+    alignas(16) double ids[2];
+    _mm_store_pd(ts, lane_best);
+    _mm_store_pd(ids, lane_index);
+    for (int lane = 0; lane < 2; lane++) {
+        // Ties go to the lower index, matching the scalar order
+        size_t id = static_cast<size_t>(ids[lane]);
+        if (ids[lane] >= 0 && (ts[lane] < best || (ts[lane] == best && id < best_index))) {
+            best = ts[lane];
+            best_index = id;
+        }
+    }
+#endif
+
+    for (; i < end; i++) {
+        double s[3], v[3];
+        for (int r = 0; r < 3; r++) {
+            s[r] = set.m_[r][0][i] * o[0] + set.m_[r][1][i] * o[1] + set.m_[r][2][i] * o[2] + set.m_[r][3][i];
+            v[r] = set.m_[r][0][i] * d[0] + set.m_[r][1][i] * d[1] + set.m_[r][2][i] * d[2];
+        }
+        double a = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+        double b = 2.0 * (v[0] * s[0] + v[1] * s[1] + v[2] * s[2]);
+        double c = s[0] * s[0] + s[1] * s[1] + s[2] * s[2] - set.radius2_[i];
+        double disc = (b * b) - (4.0 * a * c);
+        if (disc < 0.0) {
+            continue;
+        }
+        double sqrt_disc = std::sqrt(disc);
+        double t1 = (-b - sqrt_disc) / (2.0 * a);
+        double t2 = (-b + sqrt_disc) / (2.0 * a);
+        double t = t1 >= t_min ? t1 : t2;
+        if (t >= t_min && t < best) {
+            best = t;
+            best_index = i;
+        }
+    }
+
+    if (best_index == end) {
+        return false;
+    }
+    t_max = best;
+    index = best_index;
+    return true;
+}
+
+bool any_hit(const SphereSet& set, const Ray& ray, size_t begin, size_t end,
+             double t_min, double t_max) {
+    // Blocks keep the vector kernel busy while still stopping early
+    const size_t block = 64;
+    for (size_t i = begin; i < end; i += block) {
+        double t = t_max;
+        size_t index;
+        if (nearest_hit(set, ray, i, std::min(i + block, end), t_min, t, index)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::optional<Intersection> hit(const SphereSet& set, const Ray& ray) {
+    count(Counter::Rays);
+    double t = std::numeric_limits<double>::infinity();
+    size_t index;
+    if (!nearest_hit(set, ray, 0, set.size(), 0.0, t, index)) {
+        return std::nullopt;
+    }
+    count(Counter::Hits);
+    return intersection(t, set[index]);
+}
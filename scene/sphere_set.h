@@ -0,0 +1,53 @@
+#ifndef SPHERE_SET_H
+#define SPHERE_SET_H
+
+#include "ray/ray.h"
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+// A collection of spheres laid out for intersecting one ray against many of
+// them. Besides a copy of each Sphere (for shading), the set keeps each
+// sphere's inverse transform and radius in structure-of-arrays form, so the
+// kernel loads the same component of several spheres as one vector.
+//
+// Transforms are treated as affine (bottom row 0 0 0 1), as every transform
+// built by this library is, and rays are expected to have a point origin and
+// a vector direction.
+class SphereSet {
+public:
+    void add(const Sphere& s);
+    void reserve(size_t count);
+    void clear();
+
+    size_t size() const { return spheres_.size(); }
+    bool empty() const { return spheres_.empty(); }
+    const Sphere& operator[](size_t i) const { return spheres_[i]; }
+
+    friend bool nearest_hit(const SphereSet& set, const Ray& ray, size_t begin, size_t end,
+                            double t_min, double& t_max, size_t& index);
+
+private:
+    std::vector<Sphere> spheres_;
+    // Rows 0-2 of each inverse transform; column 3 also has the sphere's
+    // origin subtracted, so it maps a ray origin straight to sphere_to_ray
+    std::vector<double> m_[3][4];
+    std::vector<double> radius2_;
+};
+
+// Finds the nearest intersection with t_min <= t < t_max among spheres
+// [begin, end) of the set. On a hit, lowers t_max to it, stores the
+// sphere's index and returns true; otherwise leaves both untouched.
+bool nearest_hit(const SphereSet& set, const Ray& ray, size_t begin, size_t end,
+                 double t_min, double& t_max, size_t& index);
+
+// True if any sphere in [begin, end) is hit with t_min <= t < t_max.
+// Returns as soon as one block of spheres yields a hit.
+bool any_hit(const SphereSet& set, const Ray& ray, size_t begin, size_t end,
+             double t_min, double t_max);
+
+// The hit (lowest nonnegative t) of ray against every sphere in the set.
+// The intersection points into the set, so it is valid until the set changes.
+std::optional<Intersection> hit(const SphereSet& set, const Ray& ray);
+
+#endif // SPHERE_SET_H
@@ -0,0 +1,48 @@
+#include "world.h"
+#include "stats/stats.h"
+#include "stats/trace.h"
+
+void World::add(const Sphere& s) {
+    spheres_.push_back(s);
+    pending_.add(s);
+}
+
+void World::commit() {
+    PhaseTimer timer(Phase::Setup);
+    TraceScope trace("scene setup");
+    bvh_ = Bvh(spheres_);
+    committed_ = spheres_.size();
+    pending_.clear();
+}
+
+std::optional<Intersection> closest_hit(const World& world, const Ray& ray,
+                                        double t_min, double t_max) {
+    count(Counter::Rays);
+    double t = t_max;
+    size_t index;
+    const Sphere* object = nullptr;
+
+    if (nearest_hit(world.bvh_, ray, t_min, t, index)) {
+        object = &world.spheres_[world.bvh_.source_index(index)];
+    }
+    // Pending shapes only need to beat what the hierarchy found
+    if (nearest_hit(world.pending_, ray, 0, world.pending_.size(), t_min, t, index)) {
+        object = &world.spheres_[world.committed_ + index];
+    }
+
+    if (object == nullptr) {
+        return std::nullopt;
+    }
+    count(Counter::Hits);
+    return intersection(t, *object);
+}
+
+bool any_hit(const World& world, const Ray& ray, double t_max) {
+    count(Counter::Rays);
+    bool found = any_hit(world.bvh_, ray, 0.0, t_max) ||
+                 any_hit(world.pending_, ray, 0, world.pending_.size(), 0.0, t_max);
+    if (found) {
+        count(Counter::Hits);
+    }
+    return found;
+}
@@ -0,0 +1,53 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "ray/ray.h"
+#include "scene/bvh.h"
+#include "scene/sphere_set.h"
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <vector>
+
+// The scene: owns its shapes and answers ray queries against all of them.
+//
+// Shapes added since the last commit() are kept in a small pending set and
+// tested exhaustively; commit() rebuilds the hierarchy over everything.
+// Queries are const and safe to run from several threads at once, as long
+// as nothing calls add() or commit() meanwhile.
+class World {
+public:
+    void add(const Sphere& s);
+    // Rebuilds the acceleration structure over every shape added so far
+    void commit();
+
+    size_t size() const { return spheres_.size(); }
+    bool empty() const { return spheres_.empty(); }
+    // Shapes in the order they were added
+    const Sphere& operator[](size_t i) const { return spheres_[i]; }
+
+    friend std::optional<Intersection> closest_hit(const World& world, const Ray& ray,
+                                                   double t_min, double t_max);
+    friend bool any_hit(const World& world, const Ray& ray, double t_max);
+
+private:
+    std::vector<Sphere> spheres_;
+    Bvh bvh_;
+    // spheres_[committed_...] are not in the hierarchy yet
+    size_t committed_ = 0;
+    SphereSet pending_;
+};
+
+// The nearest intersection with t_min <= t < t_max. Subtrees that start
+// beyond the closest hit found so far are never visited. The intersection
+// points at the world's own shape and is valid until the world changes.
+std::optional<Intersection> closest_hit(const World& world, const Ray& ray,
+                                        double t_min = 0.0,
+                                        double t_max = std::numeric_limits<double>::infinity());
+
+// True if anything is hit with 0 <= t < t_max; returns at the first
+// occluder found, for shadow and visibility rays
+bool any_hit(const World& world, const Ray& ray,
+             double t_max = std::numeric_limits<double>::infinity());
+
+#endif // WORLD_H
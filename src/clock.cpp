@@ -4,8 +4,30 @@
 
 #include "tuple/tuple.h"
 #include "matrix/matrix.h"
+#include "matrix/affine.h"
+#include <array>
 #include <cmath>
 
+// Twelve o'clock is at (0, 0, 1) in 3D; we rotate it around the y-axis.
+constexpr Tuple twelve = point(0, 0, 1);
+constexpr double radians_per_hour = 2.0 * M_PI / 12.0;  // π/6
+
+// The hour positions only depend on constants, so the rotations and the
+// points they produce are computed at compile time
+constexpr std::array<Tuple, 12> hour_positions() {
+    std::array<Tuple, 12> positions{};
+    for (int hour = 0; hour < 12; hour++) {
+        Affine3 r(rotation_y(hour * radians_per_hour));
+        positions[hour] = transform_point(r, twelve);
+    }
+    return positions;
+}
+
+constexpr std::array<Tuple, 12> hours = hour_positions();
+static_assert(hours[0] == point(0, 0, 1), "12 o'clock is on the +z axis");
+static_assert(hours[3] == point(1, 0, 0), "3 o'clock is on the +x axis");
+static_assert(hours[6] == point(0, 0, -1), "6 o'clock is on the -z axis");
+
 int main() {
     const int canvas_size = 400;
     const double radius = (3.0 / 8.0) * canvas_size;  // clock radius on canvas
@@ -15,15 +37,7 @@ int main() {
     Canvas c = canvas(canvas_size, canvas_size);
     Color white = color(1, 1, 1);
 
-    // Twelve o'clock is at (0, 0, 1) in 3D; we rotate it around the y-axis.
-    Tuple twelve = point(0, 0, 1);
-    const double radians_per_hour = 2.0 * M_PI / 12.0;  // π/6
-
-    for (int hour = 0; hour < 12; hour++) {
-        double angle = hour * radians_per_hour;
-        Matrix r = rotation_y(angle);
-        Tuple pos = multiply(r, twelve);
-
+    for (const Tuple& pos : hours) {
         // Map 3D (x, z) to canvas: x → pixel x, z → pixel y.
         // Positive z is "up" (12 o'clock), so subtract from center_y.
         int px = static_cast<int>(std::round(center_x + radius * pos.x));
@@ -0,0 +1,42 @@
+#include "tuple/tuple.h"
+#include <cstdlib>
+#include <iostream>
+
+// Compares two PPM images, e.g. a fresh render against a golden copy:
+//   ppmdiff expected.ppm actual.ppm [tolerance]
+// Exits 0 when they match within the tolerance (in 0-255 levels), 1 when
+// they differ and 2 when either file cannot be read.
+int main(int argc, char** argv) {
+    if (argc < 3 || argc > 4) {
+        std::cerr << "usage: ppmdiff expected.ppm actual.ppm [tolerance]" << std::endl;
+        return 2;
+    }
+    int tolerance = argc == 4 ? std::atoi(argv[3]) : 0;
+
+    Canvas expected = canvas(0, 0);
+    Canvas actual = canvas(0, 0);
+    if (!load_ppm(argv[1], expected)) {
+        std::cerr << "cannot read " << argv[1] << std::endl;
+        return 2;
+    }
+    if (!load_ppm(argv[2], actual)) {
+        std::cerr << "cannot read " << argv[2] << std::endl;
+        return 2;
+    }
+
+    ImageDiff diff = diff_canvases(expected, actual, tolerance);
+    if (!diff.same_size) {
+        std::cout << "size differs: " << expected.width << "x" << expected.height
+                  << " vs " << actual.width << "x" << actual.height << std::endl;
+        return 1;
+    }
+    std::cout << "differing pixels: " << diff.differing_pixels << std::endl;
+    std::cout << "max error: " << diff.max_error << std::endl;
+    std::cout << "mean error: " << diff.mean_error << std::endl;
+    if (!diff.identical()) {
+        std::cout << "region: (" << diff.min_x << ", " << diff.min_y << ") - ("
+                  << diff.max_x << ", " << diff.max_y << ")" << std::endl;
+        return 1;
+    }
+    return 0;
+}
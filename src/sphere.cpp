@@ -1,8 +1,20 @@
 #include "tuple/tuple.h"
 #include "ray/ray.h"
+#include "render/render.h"
+#include "scene/world.h"
+#include "stats/stats.h"
+#include "stats/trace.h"
+#include <cstring>
 #include <iostream>
 
-int main() {
+// Pass --trace <file> to also record a Chrome trace of the render
+int main(int argc, char** argv) {
+    const char* trace_file = nullptr;
+    if (argc == 3 && std::strcmp(argv[1], "--trace") == 0) {
+        trace_file = argv[2];
+        start_tracing();
+    }
+
     const int canvas_pixels = 100;
     const double wall_z = 10.0;
     const double wall_size = 7.0;
@@ -12,25 +24,34 @@ int main() {
 
     Canvas c = canvas(canvas_pixels, canvas_pixels);
     Color red = color(1, 0, 0);
-    Sphere shape = sphere();
+    Color black = color(0, 0, 0);
+    World world;
+    world.add(sphere());
+    world.commit();
 
-    for (int y = 0; y < canvas_pixels; y++) {
+    // Silhouette pixels get up to 16 samples, the rest one
+    SamplingReport sampling = render_adaptive(c, [&](double x, double y) {
         double world_y = half - pixel_size * y;
-        for (int x = 0; x < canvas_pixels; x++) {
-            double world_x = -half + pixel_size * x;
-            Tuple position = point(world_x, world_y, wall_z);
-            Ray r = ray(ray_origin, normalize(subtract(position, ray_origin)));
-            Intersections xs = intersect(shape, r);
-
-            if (hit(xs).has_value()) {
-                write_pixel(c, x, y, red);
-            }
-        }
-    }
+        double world_x = -half + pixel_size * x;
+        Tuple position = point(world_x, world_y, wall_z);
+        Ray r = ray(ray_origin, normalize(subtract(position, ray_origin)));
+        return closest_hit(world, r).has_value() ? red : black;
+    });
 
     save_canvas_to_file(c, "sphere.ppm");
     std::cout << "Canvas saved to sphere.ppm" << std::endl;
     std::cout << "To view on Mac, run: open sphere.ppm" << std::endl;
+    std::cout << "Samples: " << sampling.samples << " for " << sampling.pixels << " pixels ("
+              << sampling.samples_per_pixel() << " per pixel, "
+              << sampling.refined_pixels << " refined)" << std::endl;
+    std::cout << format_stats(take_stats());
+
+    if (trace_file != nullptr) {
+        stop_tracing();
+        if (write_trace(trace_file)) {
+            std::cout << "Trace saved to " << trace_file << std::endl;
+        }
+    }
 
     return 0;
 }
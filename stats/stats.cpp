@@ -0,0 +1,102 @@
+#include "stats.h"
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// Counters of live threads, and the totals of threads that have exited
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadCounters*> live;
+    uint64_t finished[COUNTER_COUNT] = {};
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// Phase times in nanoseconds; each timer adds to one once
+std::atomic<int64_t> phase_nanoseconds[PHASE_COUNT];
+
+} // namespace
+
+ThreadCounters::ThreadCounters() {
+    for (std::atomic<uint64_t>& value : values) {
+        value.store(0, std::memory_order_relaxed);
+    }
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.live.push_back(this);
+}
+
+ThreadCounters::~ThreadCounters() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        r.finished[i] += values[i].load(std::memory_order_relaxed);
+    }
+    r.live.erase(std::find(r.live.begin(), r.live.end(), this));
+}
+
+#if defined(RT_STATS)
+PhaseTimer::~PhaseTimer() {
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    phase_nanoseconds[static_cast<int>(phase_)].fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+        std::memory_order_relaxed);
+}
+#endif
+
+RenderStats take_stats() {
+    RenderStats stats;
+    Registry& r = registry();
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (int i = 0; i < COUNTER_COUNT; i++) {
+            stats.counters[i] = r.finished[i];
+            r.finished[i] = 0;
+        }
+        for (ThreadCounters* counters : r.live) {
+            for (int i = 0; i < COUNTER_COUNT; i++) {
+                stats.counters[i] += counters->values[i].exchange(0, std::memory_order_relaxed);
+            }
+        }
+    }
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        stats.seconds[i] = phase_nanoseconds[i].exchange(0, std::memory_order_relaxed) * 1e-9;
+    }
+    return stats;
+}
+
+std::string format_stats(const RenderStats& stats) {
+    if (!STATS_ENABLED) {
+        return "Render statistics are disabled (RAY_TRACER_STATS)\n";
+    }
+    uint64_t rays = stats[Counter::Rays];
+    double per_ray = rays > 0 ? 1.0 / static_cast<double>(rays) : 0.0;
+    char buffer[512];
+    std::snprintf(buffer, sizeof(buffer),
+                  "Render statistics\n"
+                  "  rays          %12llu\n"
+                  "  shape tests   %12llu  (%.2f per ray)\n"
+                  "  hits          %12llu  (%.1f%% of rays)\n"
+                  "  normals       %12llu\n"
+                  "  inversions    %12llu\n"
+                  "  setup         %12.3f ms\n"
+                  "  render        %12.3f ms\n"
+                  "  encode        %12.3f ms\n",
+                  static_cast<unsigned long long>(rays),
+                  static_cast<unsigned long long>(stats[Counter::ShapeTests]),
+                  stats[Counter::ShapeTests] * per_ray,
+                  static_cast<unsigned long long>(stats[Counter::Hits]),
+                  100.0 * stats[Counter::Hits] * per_ray,
+                  static_cast<unsigned long long>(stats[Counter::Normals]),
+                  static_cast<unsigned long long>(stats[Counter::Inverses]),
+                  stats[Phase::Setup] * 1e3,
+                  stats[Phase::Render] * 1e3,
+                  stats[Phase::Encode] * 1e3);
+    return buffer;
+}
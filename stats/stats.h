@@ -0,0 +1,108 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Render statistics: event counters kept per thread and wall time per
+// phase, merged by take_stats() once a frame is done. Built when RT_STATS
+// is defined (the RAY_TRACER_STATS option); otherwise count() and
+// PhaseTimer are empty and compile away.
+
+#if defined(RT_STATS)
+constexpr bool STATS_ENABLED = true;
+#else
+constexpr bool STATS_ENABLED = false;
+#endif
+
+enum class Counter {
+    // Rays cast into a scene: closest_hit() and any_hit() on a World, hit()
+    // on a Bvh or SphereSet. Rays only intersected shape by shape are not
+    // counted.
+    Rays,
+    // Ray/shape intersection tests, one per ray and shape, including the
+    // tests made by shadow (any_hit) queries
+    ShapeTests,
+    // Rays counted above that found an intersection
+    Hits,
+    Normals,     // normal_at() calls
+    Inverses,    // 4x4 matrix inversions
+};
+constexpr int COUNTER_COUNT = 5;
+
+enum class Phase {
+    Setup,   // scene construction, e.g. building the hierarchy
+    Render,  // shading the canvas
+    Encode,  // PPM encoding and writing
+};
+constexpr int PHASE_COUNT = 3;
+
+// Totals since the previous take_stats()
+struct RenderStats {
+    uint64_t counters[COUNTER_COUNT] = {};
+    double seconds[PHASE_COUNT] = {};
+
+    uint64_t operator[](Counter c) const { return counters[static_cast<int>(c)]; }
+    double operator[](Phase p) const { return seconds[static_cast<int>(p)]; }
+};
+
+// One thread's counters, alone on a cache line so that threads counting at
+// the same time never share one. Only the owning thread writes them.
+struct alignas(64) ThreadCounters {
+    std::atomic<uint64_t> values[COUNTER_COUNT];
+
+    // Registers with the merge list; on thread exit the counts are folded
+    // into the totals of finished threads
+    ThreadCounters();
+    ~ThreadCounters();
+};
+
+#if defined(RT_STATS)
+
+inline ThreadCounters& thread_counters() {
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+inline void count(Counter c, uint64_t n = 1) {
+    // Single writer: a plain load and store, no locked read-modify-write
+    std::atomic<uint64_t>& value = thread_counters().values[static_cast<int>(c)];
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// Adds the wall time between construction and destruction to a phase
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase phase)
+        : phase_(phase), start_(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer();
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    Phase phase_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#else
+
+inline void count(Counter, uint64_t = 1) {}
+
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase) {}
+};
+
+#endif
+
+// Sums every thread's counters and the phase times, then zeroes them. Call
+// between frames, while no other thread is counting.
+RenderStats take_stats();
+
+// Multi-line summary: counts, rates per ray and time per phase
+std::string format_stats(const RenderStats& stats);
+
+#endif // STATS_H
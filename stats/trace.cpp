@@ -0,0 +1,167 @@
+#include "trace.h"
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace trace_detail {
+std::atomic<bool> enabled{false};
+} // namespace trace_detail
+
+static int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Start of the current trace, in steady_ns() time
+static std::atomic<int64_t> epoch_ns{steady_ns()};
+
+namespace {
+
+// Single-producer ring: only the thread holding the buffer writes events,
+// and publishes each one by advancing head
+struct TraceBuffer {
+    std::unique_ptr<TraceEvent[]> events{new TraceEvent[TRACE_BUFFER_EVENTS]};
+    std::atomic<uint64_t> head{0};
+    int id = 0;
+};
+
+// Buffers outlive the threads that wrote them, so the trace can be
+// exported after the workers have been joined. A buffer whose thread has
+// exited is handed to the next new thread, so short-lived worker pools do
+// not grow the trace memory; each buffer is one timeline row.
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    std::vector<TraceBuffer*> free;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// The calling thread's claim on a buffer, returned when the thread exits
+struct BufferLease {
+    TraceBuffer* buffer = nullptr;
+
+    ~BufferLease() {
+        if (buffer != nullptr) {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.free.push_back(buffer);
+        }
+    }
+};
+
+TraceBuffer& thread_buffer() {
+    thread_local BufferLease lease;
+    if (lease.buffer == nullptr) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (!r.free.empty()) {
+            lease.buffer = r.free.back();
+            r.free.pop_back();
+        } else {
+            r.buffers.push_back(std::make_unique<TraceBuffer>());
+            lease.buffer = r.buffers.back().get();
+            lease.buffer->id = static_cast<int>(r.buffers.size());
+        }
+    }
+    return *lease.buffer;
+}
+
+// Appends name as a JSON string; names are plain identifiers in practice
+void append_json_string(std::string& out, const char* name) {
+    out += '"';
+    for (const char* c = name; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            out += '\\';
+        }
+        if (static_cast<unsigned char>(*c) >= 0x20) {
+            out += *c;
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+namespace trace_detail {
+
+int64_t now_ns() {
+    return steady_ns() - epoch_ns.load(std::memory_order_relaxed);
+}
+
+void record(const TraceEvent& event) {
+    TraceBuffer& buffer = thread_buffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % TRACE_BUFFER_EVENTS] = event;
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+} // namespace trace_detail
+
+void start_tracing() {
+    Registry& r = registry();
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (auto& buffer : r.buffers) {
+            buffer->head.store(0, std::memory_order_relaxed);
+        }
+        epoch_ns.store(steady_ns(), std::memory_order_relaxed);
+    }
+    trace_detail::enabled.store(true, std::memory_order_release);
+}
+
+void stop_tracing() {
+    trace_detail::enabled.store(false, std::memory_order_release);
+}
+
+std::string trace_json() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+           "\"args\":{\"name\":\"ray_tracer\"}}";
+    char line[160];
+    for (auto& buffer : r.buffers) {
+        std::snprintf(line, sizeof(line),
+                      ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                      "\"args\":{\"name\":\"thread %d\"}}",
+                      buffer->id, buffer->id);
+        out += line;
+
+        // Only the newest TRACE_BUFFER_EVENTS survive a wrapped ring
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t first = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+        for (uint64_t i = first; i < head; i++) {
+            const TraceEvent& e = buffer->events[i % TRACE_BUFFER_EVENTS];
+            out += ",\n{\"name\":";
+            append_json_string(out, e.name);
+            // Timestamps are in microseconds
+            std::snprintf(line, sizeof(line),
+                          ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                          buffer->id, e.start_ns * 1e-3, e.duration_ns * 1e-3);
+            out += line;
+            if (e.x >= 0 || e.y >= 0) {
+                std::snprintf(line, sizeof(line), ",\"args\":{\"x\":%d,\"y\":%d}", e.x, e.y);
+                out += line;
+            }
+            out += '}';
+        }
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+bool write_trace(const std::string& filename) {
+    std::string json = trace_json();
+    std::FILE* file = std::fopen(filename.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+    return std::fclose(file) == 0 && ok;
+}
@@ -0,0 +1,68 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Timeline tracing in the Chrome Trace Event format, for viewing in
+// Perfetto or chrome://tracing. Scopes record one complete event each into
+// a ring buffer owned by the recording thread; recording never locks, so
+// tracing barely perturbs what it measures. Off until start_tracing(), and
+// then only a flag test per scope.
+
+// Events each thread's ring buffer holds; older events are overwritten
+constexpr size_t TRACE_BUFFER_EVENTS = 1 << 15;
+
+struct TraceEvent {
+    const char* name;      // static string
+    int64_t start_ns;      // since start_tracing()
+    int64_t duration_ns;
+    int x, y;              // optional position (e.g. a tile's origin), -1 if unused
+};
+
+// Clears every buffer and starts recording
+void start_tracing();
+void stop_tracing();
+
+namespace trace_detail {
+extern std::atomic<bool> enabled;
+void record(const TraceEvent& event);
+int64_t now_ns();
+} // namespace trace_detail
+
+inline bool tracing() {
+    return trace_detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Records the time from construction to destruction as one event named
+// name, which must outlive the trace (normally a string literal)
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, int x = -1, int y = -1)
+        : name_(tracing() ? name : nullptr), x_(x), y_(y),
+          start_(name_ != nullptr ? trace_detail::now_ns() : 0) {}
+
+    ~TraceScope() {
+        if (name_ != nullptr) {
+            trace_detail::record({name_, start_, trace_detail::now_ns() - start_, x_, y_});
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    int x_, y_;
+    int64_t start_;
+};
+
+// The recorded events as a Chrome trace JSON document, one timeline row
+// per buffer. Call while no thread is recording (e.g. after the render).
+std::string trace_json();
+// Writes trace_json() to a file; returns false if it cannot be written
+bool write_trace(const std::string& filename);
+
+#endif // TRACE_H
@@ -0,0 +1,93 @@
+#include <catch2/catch_test_macros.hpp>
+#include "arena/arena.h"
+#include "ray/ray.h"
+#include "render/render.h"
+#include <cstdint>
+#include <mutex>
+#include <set>
+
+TEST_CASE("Arena allocations are aligned and disjoint", "[arena]") {
+    Arena arena(256);
+    char* a = static_cast<char*>(arena.allocate(3, 1));
+    double* b = arena.allocate<double>(4);
+    void* c = arena.allocate(10, 32);
+
+    REQUIRE(reinterpret_cast<uintptr_t>(b) % alignof(double) == 0);
+    REQUIRE(reinterpret_cast<uintptr_t>(c) % 32 == 0);
+    REQUIRE(reinterpret_cast<char*>(b) >= a + 3);
+    REQUIRE(static_cast<char*>(c) >= reinterpret_cast<char*>(b + 4));
+    REQUIRE(arena.used() >= 3 + 4 * sizeof(double) + 10);
+}
+
+TEST_CASE("An arena grows past its block size and reuses blocks after reset", "[arena]") {
+    Arena arena(256);
+    void* first = arena.allocate(200);
+    arena.allocate(200);
+    void* large = arena.allocate(1000);
+    REQUIRE(large != nullptr);
+    size_t capacity = arena.capacity();
+    REQUIRE(capacity >= 256 + 256 + 1000);
+
+    arena.reset();
+    REQUIRE(arena.used() == 0);
+    REQUIRE(arena.allocate(200) == first);
+    arena.allocate(200);
+    arena.allocate(1000);
+    REQUIRE(arena.capacity() == capacity);
+}
+
+TEST_CASE("Standard containers can keep their storage in an arena", "[arena]") {
+    Arena arena;
+    ArenaVector<int> values{ArenaAllocator<int>(&arena)};
+    for (int i = 0; i < 1000; i++) {
+        values.push_back(i);
+    }
+    REQUIRE(values[999] == 999);
+    REQUIRE(arena.used() >= 1000 * sizeof(int));
+
+    // The default allocator uses the heap
+    ArenaVector<int> heap;
+    heap.push_back(1);
+    REQUIRE(heap.get_allocator().arena() == nullptr);
+}
+
+TEST_CASE("An intersection list spills into its arena", "[arena]") {
+    Arena arena;
+    Sphere s = sphere();
+    {
+        Intersections xs(arena);
+        for (int i = 0; i < 20; i++) {
+            xs.push_back(intersection(i, s));
+        }
+        REQUIRE(xs.size() == 20);
+        REQUIRE(xs[19].t == 19);
+        REQUIRE(arena.used() >= 20 * sizeof(Intersection));
+        REQUIRE(hit(xs)->t == 0);
+    }
+    arena.reset();
+    REQUIRE(arena.used() == 0);
+}
+
+TEST_CASE("Render workers reset their arena before every tile", "[arena]") {
+    Canvas c = canvas(32, 32);
+    RenderOptions options;
+    options.threads = 3;
+    options.tile_size = 8;
+
+    std::mutex mutex;
+    size_t most_used = 0;
+    std::set<Arena*> arenas;
+    render(c, [&](double, double) {
+        Arena& arena = thread_arena();
+        arena.allocate(100);
+        std::lock_guard<std::mutex> lock(mutex);
+        arenas.insert(&arena);
+        most_used = std::max(most_used, arena.used());
+        return color(0, 0, 0);
+    }, options);
+
+    // One tile is 64 pixels of 100 bytes; without the resets the used space
+    // would keep growing with every tile a worker renders
+    REQUIRE(most_used <= 64 * (100 + alignof(std::max_align_t)));
+    REQUIRE(arenas.size() <= 3);
+}
@@ -0,0 +1,107 @@
+#include <catch2/catch_test_macros.hpp>
+#include "canvas/tiled_canvas.h"
+#include "render/render.h"
+#include "tuple/tuple.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+// A unique scratch file path; the file is removed when the guard goes away
+struct TempPath {
+    std::string path;
+
+    TempPath() {
+        char name[] = "/tmp/tiled_canvas_XXXXXX";
+        int fd = mkstemp(name);
+        if (fd >= 0) {
+            close(fd);
+        }
+        path = name;
+    }
+    ~TempPath() { unlink(path.c_str()); }
+};
+
+static Color pattern(double x, double y) {
+    return color(x / 100.0, y / 70.0, (static_cast<int>(x) * 7 + static_cast<int>(y) * 3) % 11 / 10.0);
+}
+
+static std::string read_file(std::FILE* file) {
+    std::string contents;
+    std::rewind(file);
+    char buffer[4096];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        contents.append(buffer, n);
+    }
+    return contents;
+}
+
+TEST_CASE("A tiled canvas starts black and reads back what was written", "[canvas]") {
+    TempPath file;
+    TiledCanvas c(file.path, 100, 70, 16);
+    REQUIRE(c.valid());
+    REQUIRE(c.tiles_x() == 7);
+    REQUIRE(c.tiles_y() == 5);
+    REQUIRE(pixel_at(c, 99, 69) == color(0, 0, 0));
+
+    for (int y = 0; y < 70; y++) {
+        for (int x = 0; x < 100; x++) {
+            write_pixel(c, x, y, pattern(x, y));
+        }
+    }
+    write_pixel(c, 100, 0, color(1, 1, 1));
+    write_pixel(c, -1, 5, color(1, 1, 1));
+
+    REQUIRE(pixel_at(c, 0, 0) == pattern(0, 0));
+    REQUIRE(pixel_at(c, 99, 69) == pattern(99, 69));
+    REQUIRE(pixel_at(c, 100, 0) == color(0, 0, 0));
+    // Pixels are grouped by tile: (17, 33) is row 1, column 1 of tile (1, 2)
+    REQUIRE(c.tile(1, 2)[1 * 16 + 1] == pattern(17, 33));
+    REQUIRE(c.flush());
+}
+
+TEST_CASE("A tiled canvas encodes the same PPM as a canvas", "[canvas]") {
+    TempPath file;
+    TiledCanvas tiled(file.path, 100, 70, 32);
+    Canvas reference = canvas(100, 70);
+    for (int y = 0; y < 70; y++) {
+        for (int x = 0; x < 100; x++) {
+            write_pixel(tiled, x, y, pattern(x, y));
+            write_pixel(reference, x, y, pattern(x, y));
+        }
+    }
+
+    for (PpmFormat format : {PpmFormat::P3, PpmFormat::P6}) {
+        std::FILE* out = std::tmpfile();
+        REQUIRE(out != nullptr);
+        REQUIRE(write_ppm(fileno(out), tiled, format));
+        std::string written = read_file(out);
+        std::fclose(out);
+
+        REQUIRE(written == canvas_to_ppm(reference, format));
+    }
+}
+
+TEST_CASE("Rendering into a tiled canvas matches rendering into a canvas", "[canvas]") {
+    Canvas reference = canvas(100, 70);
+    render(reference, pattern);
+
+    TempPath file;
+    TiledCanvas tiled(file.path, 100, 70, 24);
+    RenderOptions options;
+    options.threads = 3;
+    render(tiled, pattern, options);
+
+    for (int y = 0; y < 70; y++) {
+        for (int x = 0; x < 100; x++) {
+            REQUIRE(pixel_at(tiled, x, y) == pixel_at(reference, x, y));
+        }
+    }
+}
+
+TEST_CASE("A tiled canvas reports a file it cannot create", "[canvas]") {
+    TiledCanvas c("/nonexistent-directory/image.bin", 10, 10);
+    REQUIRE(c.valid() == false);
+    REQUIRE(pixel_at(c, 0, 0) == color(0, 0, 0));
+}
@@ -1,6 +1,8 @@
 #include <catch2/catch_test_macros.hpp>
 #include <cmath>
+#include <limits>
 #include "matrix/matrix.h"
+#include "matrix/affine.h"
 #include "tuple/tuple.h"
 
 TEST_CASE("Constructing and inspecting a 4x4 matrix", "[matrix]") {
@@ -645,3 +647,195 @@ TEST_CASE("Chained transformations must be applied in reverse order", "[matrix]"
     REQUIRE(equal(result.z, expected.z));
     REQUIRE(equal(result.w, expected.w));
 }
+
+TEST_CASE("A fixed-size 4x4 matrix converts to and from a generic matrix", "[matrix]") {
+    Matrix A = matrix4x4({
+        {1, 2, 3, 4},
+        {5.5, 6.5, 7.5, 8.5},
+        {9, 10, 11, 12},
+        {13.5, 14.5, 15.5, 16.5}
+    });
+    Matrix4 M(A);
+
+    REQUIRE(equal(M(0, 3), 4));
+    REQUIRE(equal(M(1, 2), 7.5));
+    REQUIRE(equal(M(3, 0), 13.5));
+
+    Matrix B = M;
+    REQUIRE(B.rows == 4);
+    REQUIRE(B.cols == 4);
+    REQUIRE(compareMatrix(A, B) == true);
+}
+
+TEST_CASE("Fixed-size matrix operations agree with the generic versions", "[matrix]") {
+    Matrix A = matrix4x4({
+        {-5, 2, 6, -8},
+        {1, -5, 1, 8},
+        {7, 7, -6, -7},
+        {1, -3, 7, 4}
+    });
+    Matrix B = matrix4x4({
+        {8, -5, 9, 2},
+        {7, 5, 6, 1},
+        {-6, 0, 9, 6},
+        {-3, 0, -9, -4}
+    });
+    Matrix4 A4(A);
+    Matrix4 B4(B);
+    Tuple t(1, 2, 3, 1);
+
+    REQUIRE(compareMatrix(matrixMultiply(A4, B4), matrixMultiply(A, B)) == true);
+    REQUIRE(multiply(A4, t) == multiply(A, t));
+    REQUIRE(compareMatrix(transpose(A4), transpose(A)) == true);
+    REQUIRE(compareMatrix(submatrix(A4, 2, 1), submatrix(A, 2, 1)) == true);
+    REQUIRE(equal(cofactor(A4, 2, 3), cofactor(A, 2, 3)));
+    REQUIRE(equal(determinant(A4), determinant(A)));
+    REQUIRE(compareMatrix(inverse(A4), inverse(A)) == true);
+}
+
+TEST_CASE("The inverse of a noninvertible fixed-size matrix is the zero matrix", "[matrix]") {
+    Matrix4 A(matrix4x4({
+        {-4, 2, -2, -3},
+        {9, 6, 2, 6},
+        {0, -5, 1, -5},
+        {0, 0, 0, 0}
+    }));
+
+    REQUIRE(is_invertible(A) == false);
+    REQUIRE(compareMatrix(inverse(A), Matrix4()) == true);
+}
+
+TEST_CASE("Inverting a 4x4 matrix also reports its determinant", "[matrix]") {
+    Matrix4 A(matrix4x4({
+        {9, 3, 0, 9},
+        {-5, -2, -6, -3},
+        {-4, 9, 6, 4},
+        {-7, 6, 6, 2}
+    }));
+    double det = 0;
+    Matrix4 B = inverse(A, det);
+
+    REQUIRE(equal(det, determinant(A)));
+    REQUIRE(compareMatrix(B, inverse(A)) == true);
+    REQUIRE(compareMatrix(matrixMultiply(A, B), identity_matrix()) == true);
+}
+
+TEST_CASE("Single-precision matrices match double precision", "[matrix]") {
+    Matrix4 A = matrixMultiply(matrixMultiply(translation(1, -2, 3), rotation_y(0.7)),
+                               scaling(2, 3, 4));
+    Matrix4f F = matrixMultiply(matrixMultiply(translation<float>(1, -2, 3), rotation_y<float>(0.7f)),
+                                scaling<float>(2, 3, 4));
+    Matrix4f Finv = inverse(F);
+    Matrix4 Ainv = inverse(A);
+
+    for (int i = 0; i < 16; i++) {
+        REQUIRE(std::abs(F.data[i] - A.data[i]) < Precision<float>::epsilon);
+        REQUIRE(std::abs(Finv.data[i] - Ainv.data[i]) < Precision<float>::epsilon);
+    }
+    REQUIRE(compareMatrix(matrixMultiply(F, Finv), identity_matrix<float>()) == true);
+
+    Tuplef p = multiply(F, point<float>(1, 2, 3));
+    Tuple q = multiply(A, point(1, 2, 3));
+    REQUIRE(std::abs(p.x - q.x) < Precision<float>::epsilon);
+    REQUIRE(std::abs(p.y - q.y) < Precision<float>::epsilon);
+    REQUIRE(std::abs(p.z - q.z) < Precision<float>::epsilon);
+    REQUIRE(p.is_point());
+}
+
+TEST_CASE("An affine transform converts to and from a 4x4 matrix", "[affine]") {
+    Matrix4 m = matrixMultiply(translation(1, -2, 3), rotation_y(0.7));
+    Affine3 a(m);
+
+    REQUIRE(equal(a(0, 3), 1));
+    REQUIRE(equal(a(1, 3), -2));
+    REQUIRE(compareMatrix(to_matrix(a), m) == true);
+    REQUIRE(compareMatrix(to_matrix(identity_affine()), identity_matrix()) == true);
+
+    Matrix generic = to_matrix(a);
+    REQUIRE(Affine3(generic) == a);
+}
+
+TEST_CASE("Composing affine transforms matches the 4x4 product", "[affine]") {
+    Matrix4 A = matrixMultiply(translation(1, -2, 3), shearing(0.1, 0.2, 0.3, 0.4, 0.5, 0.6));
+    Matrix4 B = matrixMultiply(rotation_x(0.3), scaling(2, 3, 4));
+
+    REQUIRE(compareMatrix(to_matrix(matrixMultiply(Affine3(A), Affine3(B))),
+                          matrixMultiply(A, B)) == true);
+
+    // The packed run-time kernels agree with the portable composition
+    REQUIRE(matrixMultiply(Affine3(A), Affine3(B)) == affine_product_scalar(Affine3(A), Affine3(B)));
+    Affine3f af{Matrix4f(Matrix(A))};
+    Affine3f bf{Matrix4f(Matrix(B))};
+    REQUIRE(matrixMultiply(af, bf) == affine_product_scalar(af, bf));
+}
+
+TEST_CASE("Transforming tuples with an affine transform", "[affine]") {
+    Matrix4 m = matrixMultiply(matrixMultiply(translation(5, -3, 2), rotation_z(1.1)),
+                               scaling(2, 3, 4));
+    Affine3 a(m);
+    Tuple p = point(-3, 4, 5);
+    Tuple v = vector(-3, 4, 5);
+
+    REQUIRE(multiply(a, p) == multiply(m, p));
+    REQUIRE(multiply(a, v) == multiply(m, v));
+    REQUIRE(transform_point(a, p) == multiply(m, p));
+    REQUIRE(transform_vector(a, v) == multiply(m, v));
+    // Translation does not affect vectors
+    REQUIRE(transform_vector(Affine3(translation(5, -3, 2)), v) == v);
+
+    Tuple n = transform_normal(inverse(a), v);
+    Tuple expected = multiply(transpose(inverse(m)), v);
+    expected.w = 0;
+    REQUIRE(n == expected);
+}
+
+TEST_CASE("Inverting an affine transform", "[affine]") {
+    Matrix4 m = matrixMultiply(matrixMultiply(translation(1, -2, 3), rotation_y(0.7)),
+                               shearing(0.1, 0.2, 0.3, 0.4, 0.5, 0.6));
+    Affine3 a(m);
+
+    REQUIRE(equal(determinant(a), determinant(m)));
+    REQUIRE(is_invertible(a));
+    REQUIRE(compareMatrix(to_matrix(inverse(a)), inverse(m)) == true);
+    REQUIRE(matrixMultiply(a, inverse(a)) == identity_affine());
+
+    Affine3 singular(scaling(1, 0, 1));
+    REQUIRE(is_invertible(singular) == false);
+    REQUIRE(inverse(singular) == Affine3());
+}
+
+TEST_CASE("Transforms can be built and checked at compile time", "[matrix]") {
+    constexpr Matrix4 chain = matrixMultiply(translation(10, 5, 7),
+                                             matrixMultiply(scaling(5, 5, 5), rotation_x(M_PI / 2)));
+    constexpr Affine3 affine(chain);
+
+    STATIC_REQUIRE(transform_point(affine, point(1, 0, 1)) == point(15, 0, 7));
+    STATIC_REQUIRE(transform_vector(affine, vector(0, 1, 0)) == vector(0, 0, 5));
+    STATIC_REQUIRE(transpose(transpose(chain)) == chain);
+    STATIC_REQUIRE(matrixMultiply(affine, inverse(affine)) == identity_affine());
+    STATIC_REQUIRE(rotation_z(M_PI / 2)(1, 0) == 1.0);
+    STATIC_REQUIRE(color(1, 0.5, 0).green() == 0.5);
+}
+
+TEST_CASE("Compile-time sine and cosine match the library functions", "[matrix]") {
+    for (int i = -720; i <= 720; i++) {
+        double x = i * M_PI / 180.0 + 0.001 * i;
+        REQUIRE(std::abs(constexpr_sin(x) - std::sin(x)) < 1e-15);
+        REQUIRE(std::abs(constexpr_cos(x) - std::cos(x)) < 1e-15);
+    }
+}
+
+TEST_CASE("Compile-time sine and cosine reject angles they cannot reduce", "[matrix]") {
+    REQUIRE(std::abs(constexpr_sin(1e6) - std::sin(1e6)) < 1e-10);
+    REQUIRE(std::isnan(constexpr_sin(1e15)));
+    REQUIRE(std::isnan(constexpr_cos(-1e20)));
+    REQUIRE(std::isnan(constexpr_sin(std::numeric_limits<double>::infinity())));
+    STATIC_REQUIRE(constexpr_sin(1e20) != constexpr_sin(1e20));
+}
+
+TEST_CASE("Rotations built at run time use the library functions", "[matrix]") {
+    double angle = 1e15;
+    REQUIRE(rotation_x(angle)(1, 1) == std::cos(angle));
+    REQUIRE(rotation_y(angle)(0, 2) == std::sin(angle));
+    REQUIRE(rotation_z(angle)(1, 0) == std::sin(angle));
+}
@@ -3,15 +3,10 @@
 #include "matrix/matrix.h"
 #include <catch2/catch_test_macros.hpp>
 #include <cmath>
-
-static bool same_sphere(const Sphere& a, const Sphere& b) {
-    return a.origin == b.origin &&
-           equal(a.radius, b.radius) &&
-           compareMatrix(a.transform, b.transform);
-}
+#include <type_traits>
 
 static bool same_intersection(const Intersection& a, const Intersection& b) {
-    return equal(a.t, b.t) && same_sphere(a.object, b.object);
+    return equal(a.t, b.t) && a.object == b.object;
 }
 
 TEST_CASE("Creating and querying a ray", "[ray]") {
@@ -86,12 +81,42 @@ TEST_CASE("A sphere is behind a ray", "[ray]") {
     REQUIRE(equal(xs[1].t, -4.0));
 }
 
+TEST_CASE("Intersecting a ray packet matches intersecting each ray", "[ray]") {
+    Ray rays[RAY_PACKET_SIZE] = {
+        ray(point(0, 0, -5), vector(0, 0, 1)),   // two points
+        ray(point(0, 1, -5), vector(0, 0, 1)),   // tangent
+        ray(point(0, 2, -5), vector(0, 0, 1)),   // miss
+        ray(point(0, 0, 0), normalize(vector(1, 2, 3))),  // inside
+    };
+    Sphere s = sphere();
+    set_transform(s, matrixMultiply(scaling(1, 1.5, 1), rotation_z(0.3)));
+    PacketIntersections packet = intersect(s, ray_packet(rays));
+
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        Intersections xs = intersect(s, rays[i]);
+        bool lane_hit = (packet.mask & (1 << i)) != 0;
+        REQUIRE(lane_hit == (xs.size() == 2));
+        if (lane_hit) {
+            REQUIRE(equal(packet.t0[i], xs[0].t));
+            REQUIRE(equal(packet.t1[i], xs[1].t));
+        } else {
+            REQUIRE(std::isinf(packet.t0[i]));
+        }
+    }
+    REQUIRE(packet.mask == 0xB);
+}
+
 TEST_CASE("An intersection encapsulates t and object", "[intersections]") {
     Sphere s = sphere();
     Intersection i = intersection(3.5, s);
 
     REQUIRE(equal(i.t, 3.5));
-    REQUIRE(same_sphere(i.object, s));
+    REQUIRE(i.object == &s);
+}
+
+TEST_CASE("An intersection is a trivially copyable record", "[intersections]") {
+    STATIC_REQUIRE(std::is_trivially_copyable<Intersection>::value);
+    REQUIRE(sizeof(Intersection) == sizeof(double) + sizeof(const Sphere*));
 }
 
 TEST_CASE("Aggregating intersections", "[intersections]") {
@@ -105,14 +130,52 @@ TEST_CASE("Aggregating intersections", "[intersections]") {
     REQUIRE(equal(xs[1].t, 2.0));
 }
 
+TEST_CASE("Intersections spill past their inline capacity", "[intersections]") {
+    Sphere s = sphere();
+    Intersections xs;
+    const size_t count = Intersections::INLINE_CAPACITY * 3;
+    for (size_t i = 0; i < count; i++) {
+        xs.push_back(intersection(static_cast<double>(i), s));
+    }
+
+    REQUIRE(xs.size() == count);
+    for (size_t i = 0; i < count; i++) {
+        REQUIRE(equal(xs[i].t, static_cast<double>(i)));
+    }
+
+    xs.clear();
+    REQUIRE(xs.empty());
+    xs.push_back(intersection(4.5, s));
+    REQUIRE(xs.size() == 1);
+    REQUIRE(equal(xs[0].t, 4.5));
+}
+
+TEST_CASE("Intersecting a ray with several spheres into one list", "[ray]") {
+    Ray r = ray(point(0, 0, -5), vector(0, 0, 1));
+    Sphere s1 = sphere();
+    Sphere s2 = sphere();
+    set_transform(s2, translation(0, 0, 10));
+    Intersections xs;
+    intersect(s1, r, xs);
+    intersect(s2, r, xs);
+
+    REQUIRE(xs.size() == 4);
+    REQUIRE(equal(xs[0].t, 4.0));
+    REQUIRE(equal(xs[1].t, 6.0));
+    REQUIRE(xs[1].object == &s1);
+    REQUIRE(equal(xs[2].t, 14.0));
+    REQUIRE(equal(xs[3].t, 16.0));
+    REQUIRE(xs[3].object == &s2);
+}
+
 TEST_CASE("Intersect sets the object on the intersection", "[ray]") {
     Ray r = ray(point(0, 0, -5), vector(0, 0, 1));
     Sphere s = sphere();
     Intersections xs = intersect(s, r);
 
     REQUIRE(xs.size() == 2);
-    REQUIRE(same_sphere(xs[0].object, s));
-    REQUIRE(same_sphere(xs[1].object, s));
+    REQUIRE(xs[0].object == &s);
+    REQUIRE(xs[1].object == &s);
 }
 
 TEST_CASE("The hit, when all intersections have positive t", "[intersections]") {
@@ -181,16 +244,34 @@ TEST_CASE("Scaling a ray", "[ray]") {
     REQUIRE(r2.direction == vector(0, 3, 0));
 }
 
+TEST_CASE("Transforming a single-precision ray", "[ray]") {
+    Rayf r = ray(point<float>(1, 2, 3), vector<float>(0, 1, 0));
+    Rayf r2 = transform(r, matrixMultiply(translation<float>(3, 4, 5), scaling<float>(2, 3, 4)));
+
+    REQUIRE(r2.origin == point<float>(5, 10, 17));
+    REQUIRE(r2.direction == vector<float>(0, 3, 0));
+    REQUIRE(position(r2, 2) == point<float>(5, 16, 17));
+}
+
 TEST_CASE("A sphere's default transformation", "[sphere]") {
     Sphere s = sphere();
-    REQUIRE(compareMatrix(s.transform, identity_matrix()));
+    REQUIRE(compareMatrix(s.transform(), identity_matrix()));
 }
 
 TEST_CASE("Changing a sphere's transformation", "[sphere]") {
     Sphere s = sphere();
     Matrix t = translation(2, 3, 4);
     set_transform(s, t);
-    REQUIRE(compareMatrix(s.transform, t));
+    REQUIRE(compareMatrix(s.transform(), t));
+}
+
+TEST_CASE("Changing a sphere's transformation updates its cached inverses", "[sphere]") {
+    Sphere s = sphere();
+    Matrix4 t = matrixMultiply(translation(2, 3, 4), scaling(1, 2, 3));
+    set_transform(s, t);
+
+    REQUIRE(compareMatrix(s.inverse_transform(), inverse(t)));
+    REQUIRE(compareMatrix(s.inverse_transpose(), transpose(inverse(t))));
 }
 
 TEST_CASE("Intersecting a scaled sphere with a ray", "[sphere]") {
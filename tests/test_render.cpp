@@ -0,0 +1,243 @@
+#include "render/render.h"
+#include "tuple/tuple.h"
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+// A shader with uneven cost across the image, so workers finish at
+// different times and have to steal
+static Color gradient(double x, double y) {
+    double sum = 0;
+    int iterations = (static_cast<int>(x) % 7) * 200;
+    for (int i = 0; i < iterations; i++) {
+        sum += 1e-9 * i;
+    }
+    return color(x / 64.0, y / 48.0, sum);
+}
+
+TEST_CASE("Tiles cover the canvas exactly once", "[render]") {
+    std::vector<Tile> tiles = make_tiles(37, 20, 16);
+    REQUIRE(tiles.size() == 6);
+
+    std::vector<int> covered(37 * 20, 0);
+    for (const Tile& t : tiles) {
+        for (int y = t.y0; y < t.y1; y++) {
+            for (int x = t.x0; x < t.x1; x++) {
+                covered[y * 37 + x]++;
+            }
+        }
+    }
+    for (int c : covered) {
+        REQUIRE(c == 1);
+    }
+}
+
+TEST_CASE("Every tile is run exactly once", "[render]") {
+    std::vector<Tile> tiles = make_tiles(100, 100, 8);
+    std::vector<std::atomic<int>> runs(tiles.size());
+    std::atomic<int> bad_workers(0);
+    // Catch2 assertions are not thread-safe, so only record from workers
+    run_tiles(tiles, 4, [&](const Tile& tile, int worker) {
+        if (worker < 0 || worker >= 4) {
+            bad_workers++;
+        }
+        size_t index = static_cast<size_t>(&tile - tiles.data());
+        runs[index]++;
+    });
+
+    REQUIRE(bad_workers.load() == 0);
+    for (const auto& r : runs) {
+        REQUIRE(r.load() == 1);
+    }
+}
+
+TEST_CASE("Rendering samples each pixel at its corner", "[render]") {
+    Canvas c = canvas(64, 48);
+    render(c, gradient);
+
+    REQUIRE(pixel_at(c, 0, 0) == gradient(0, 0));
+    REQUIRE(pixel_at(c, 63, 47) == gradient(63, 47));
+    REQUIRE(pixel_at(c, 17, 30) == gradient(17, 30));
+}
+
+TEST_CASE("Rendered output does not depend on the thread count", "[render]") {
+    RenderOptions one;
+    one.threads = 1;
+    Canvas reference = canvas(64, 48);
+    render(reference, gradient, one);
+
+    for (int threads : {2, 3, 8}) {
+        RenderOptions options;
+        options.threads = threads;
+        options.tile_size = 5;
+        Canvas c = canvas(64, 48);
+        render(c, gradient, options);
+
+        for (size_t i = 0; i < c.pixels.size(); i++) {
+            REQUIRE(c.pixels[i].red() == reference.pixels[i].red());
+            REQUIRE(c.pixels[i].green() == reference.pixels[i].green());
+            REQUIRE(c.pixels[i].blue() == reference.pixels[i].blue());
+        }
+    }
+}
+
+TEST_CASE("Progressive rendering ends with the same image as render", "[render]") {
+    Canvas reference = canvas(63, 47);
+    render(reference, gradient);
+
+    ProgressiveOptions options;
+    options.threads = 3;
+    options.tile_size = 5;
+    std::vector<RenderPass> passes;
+    Canvas first = canvas(63, 47);
+    Canvas c = canvas(63, 47);
+    render_progressive(c, gradient, options, [&](const Canvas& image, const RenderPass& pass) {
+        if (passes.empty()) {
+            first = image;
+        }
+        passes.push_back(pass);
+        return true;
+    });
+
+    REQUIRE(passes.size() == 4);
+    REQUIRE(passes[0].step == 8);
+    REQUIRE(passes[0].samples == 0);
+    REQUIRE(passes[3].step == 1);
+    REQUIRE(passes[3].samples == 1);
+    for (size_t i = 0; i < c.pixels.size(); i++) {
+        REQUIRE(c.pixels[i] == reference.pixels[i]);
+    }
+
+    // The coarse pass fills each 8x8 block with its top-left sample
+    REQUIRE(pixel_at(first, 5, 3) == gradient(0, 0));
+    REQUIRE(pixel_at(first, 62, 46) == gradient(56, 40));
+}
+
+TEST_CASE("Progressive refinement shades each pixel once", "[render]") {
+    const int width = 37, height = 29;
+    std::vector<std::atomic<int>> shaded(width * height);
+    for (std::atomic<int>& n : shaded) {
+        n = 0;
+    }
+    ProgressiveOptions options;
+    options.threads = 4;
+    options.tile_size = 6;
+    options.initial_step = 12;
+    Canvas c = canvas(width, height);
+    render_progressive(c, [&](double x, double y) {
+        shaded[static_cast<int>(y) * width + static_cast<int>(x)]++;
+        return color(0, 0, 0);
+    }, options);
+
+    for (const std::atomic<int>& n : shaded) {
+        REQUIRE(n.load() == 1);
+    }
+}
+
+TEST_CASE("Progressive rendering averages extra samples and can stop early", "[render]") {
+    // Varies within a pixel, so the sub-pixel offsets show up in the mean
+    auto ramp = [](double x, double) { return color(x - static_cast<int>(x), 0, 0); };
+
+    ProgressiveOptions options;
+    options.initial_step = 1;
+    options.samples_per_pixel = 4;
+    int passes = 0;
+    Canvas c = canvas(8, 8);
+    render_progressive(c, ramp, options, [&](const Canvas&, const RenderPass& pass) {
+        passes++;
+        REQUIRE(pass.samples == passes);
+        return true;
+    });
+    REQUIRE(passes == 4);
+    // Offsets 0, 0.5, 0.25 and 0.75 in x
+    REQUIRE(equal(pixel_at(c, 3, 5).red(), 0.375));
+
+    passes = 0;
+    Canvas stopped = canvas(8, 8);
+    render_progressive(stopped, ramp, options, [&](const Canvas&, const RenderPass&) {
+        return ++passes < 2;
+    });
+    REQUIRE(passes == 2);
+}
+
+// A white disc with sharp edges on black, the worst case for aliasing
+static Color disc(double x, double y) {
+    double dx = x - 40.0;
+    double dy = y - 30.0;
+    return dx * dx + dy * dy < 22.5 * 22.5 ? color(1, 1, 1) : color(0, 0, 0);
+}
+
+TEST_CASE("Adaptive sampling matches 16x supersampling at a fraction of the cost", "[render]") {
+    Canvas reference = canvas(80, 60);
+    render(reference, [](double x, double y) {
+        double sum = 0.0;
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                sum += disc(x + (i + 0.5) / 4, y + (j + 0.5) / 4).red();
+            }
+        }
+        return color(sum / 16, sum / 16, sum / 16);
+    });
+
+    Canvas c = canvas(80, 60);
+    SamplingReport report = render_adaptive(c, disc);
+
+    REQUIRE(report.pixels == 80 * 60);
+    REQUIRE(report.refined_pixels > 0);
+    REQUIRE(report.samples_per_pixel() < 2.0);
+    double max_error = 0.0;
+    for (size_t i = 0; i < c.pixels.size(); i++) {
+        max_error = std::max(max_error, std::abs(c.pixels[i].red() - reference.pixels[i].red()));
+    }
+    // Only edges clipping a cell or two of a pixel are missed
+    REQUIRE(max_error < 0.15);
+
+    // One sample per pixel is off by up to a whole pixel's coverage
+    AdaptiveOptions single;
+    single.max_samples = 1;
+    Canvas aliased = canvas(80, 60);
+    render_adaptive(aliased, disc, single);
+    double aliased_error = 0.0;
+    for (size_t i = 0; i < c.pixels.size(); i++) {
+        aliased_error = std::max(aliased_error, std::abs(aliased.pixels[i].red() - reference.pixels[i].red()));
+    }
+    REQUIRE(aliased_error > 0.4);
+}
+
+TEST_CASE("Adaptive sampling spends one sample on a flat image", "[render]") {
+    Canvas c = canvas(20, 10);
+    std::atomic<int> calls{0};
+    SamplingReport report = render_adaptive(c, [&](double, double) {
+        calls++;
+        return color(0.25, 0.5, 0.75);
+    });
+    REQUIRE(calls == 200);
+    REQUIRE(report.samples == 200);
+    REQUIRE(report.refined_pixels == 0);
+    REQUIRE(pixel_at(c, 19, 9) == color(0.25, 0.5, 0.75));
+}
+
+TEST_CASE("Adaptive output does not depend on the thread count", "[render]") {
+    AdaptiveOptions options;
+    options.tile_size = 7;
+    options.threads = 1;
+    Canvas single = canvas(80, 60);
+    SamplingReport single_report = render_adaptive(single, disc, options);
+
+    options.threads = 4;
+    Canvas multi = canvas(80, 60);
+    SamplingReport multi_report = render_adaptive(multi, disc, options);
+
+    REQUIRE(multi.pixels == single.pixels);
+    REQUIRE(multi_report.samples == single_report.samples);
+
+    // Capping at one sample per pixel is plain rendering at the first
+    // sample position
+    options.max_samples = 1;
+    Canvas aliased = canvas(80, 60);
+    REQUIRE(render_adaptive(aliased, disc, options).samples == 80 * 60);
+    REQUIRE(pixel_at(aliased, 40, 30) == color(1, 1, 1));
+    REQUIRE(pixel_at(aliased, 0, 0) == color(0, 0, 0));
+}
+
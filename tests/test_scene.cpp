@@ -0,0 +1,237 @@
+#include "scene/sphere_set.h"
+#include "scene/bvh.h"
+#include "scene/world.h"
+#include "ray/ray.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <vector>
+
+// A deterministic cloud of small spheres with mixed transforms
+static std::vector<Sphere> sphere_cloud(int count) {
+    std::vector<Sphere> spheres;
+    for (int i = 0; i < count; i++) {
+        double x = std::sin(i * 1.7) * 4.0;
+        double y = std::cos(i * 2.3) * 4.0;
+        double z = (i % 11) - 5.0;
+        Sphere s = sphere();
+        Matrix4 t = matrixMultiply(translation(x, y, z),
+                                   matrixMultiply(rotation_y(i * 0.4), scaling(0.3, 0.2 + (i % 3) * 0.1, 0.4)));
+        set_transform(s, t);
+        spheres.push_back(s);
+    }
+    return spheres;
+}
+
+// Brute-force reference: every sphere through the scalar intersect()
+static std::optional<Intersection> reference_hit(const std::vector<Sphere>& spheres, const Ray& r) {
+    Intersections xs;
+    for (const Sphere& s : spheres) {
+        intersect(s, r, xs);
+    }
+    return hit(xs);
+}
+
+TEST_CASE("A ray misses an empty sphere set", "[scene]") {
+    SphereSet set;
+    REQUIRE(!hit(set, ray(point(0, 0, -5), vector(0, 0, 1))).has_value());
+}
+
+TEST_CASE("The hit against a sphere set is the nearest nonnegative one", "[scene]") {
+    SphereSet set;
+    Sphere near = sphere();
+    set_transform(near, translation(0, 0, 3));
+    Sphere far = sphere();
+    set_transform(far, translation(0, 0, 10));
+    Sphere behind = sphere();
+    set_transform(behind, translation(0, 0, -10));
+    set.add(far);
+    set.add(behind);
+    set.add(near);
+
+    std::optional<Intersection> i = hit(set, ray(point(0, 0, 0), vector(0, 0, 1)));
+    REQUIRE(i.has_value());
+    REQUIRE(equal(i->t, 2.0));
+    REQUIRE(i->object == &set[2]);
+}
+
+TEST_CASE("A ray inside a sphere of the set hits its far side", "[scene]") {
+    SphereSet set;
+    set.add(sphere());
+
+    std::optional<Intersection> i = hit(set, ray(point(0, 0, 0), vector(0, 0, 1)));
+    REQUIRE(i.has_value());
+    REQUIRE(equal(i->t, 1.0));
+}
+
+TEST_CASE("Sphere set hits agree with intersecting every sphere", "[scene]") {
+    std::vector<Sphere> spheres = sphere_cloud(103);
+    SphereSet set;
+    for (const Sphere& s : spheres) {
+        set.add(s);
+    }
+
+    int hits = 0;
+    for (int i = 0; i < 200; i++) {
+        Tuple origin = point(std::sin(i * 0.37) * 3.0, std::cos(i * 0.91) * 3.0, -12);
+        Tuple target = point(std::cos(i * 0.53) * 2.0, std::sin(i * 0.29) * 2.0, 0);
+        Ray r = ray(origin, normalize(subtract(target, origin)));
+
+        std::optional<Intersection> expected = reference_hit(spheres, r);
+        std::optional<Intersection> actual = hit(set, r);
+        REQUIRE(actual.has_value() == expected.has_value());
+        if (expected) {
+            REQUIRE(equal(actual->t, expected->t));
+            hits++;
+        }
+    }
+    REQUIRE(hits > 20);
+}
+
+TEST_CASE("The bounds of a transformed sphere", "[scene]") {
+    Sphere s = sphere();
+    set_transform(s, matrixMultiply(translation(1, 2, 3), scaling(2, 0.5, 1)));
+    Bounds b = bounds(s);
+
+    REQUIRE(equal(b.min[0], -1));
+    REQUIRE(equal(b.max[0], 3));
+    REQUIRE(equal(b.min[1], 1.5));
+    REQUIRE(equal(b.max[1], 2.5));
+    REQUIRE(equal(b.min[2], 2));
+    REQUIRE(equal(b.max[2], 4));
+}
+
+TEST_CASE("The bounds of a rotated ellipsoid are tight", "[scene]") {
+    Sphere s = sphere();
+    set_transform(s, matrixMultiply(rotation_z(M_PI / 4), scaling(2, 1, 1)));
+    Bounds b = bounds(s);
+    double extent = std::sqrt(2.5);
+
+    REQUIRE(equal(b.max[0], extent));
+    REQUIRE(equal(b.max[1], extent));
+    REQUIRE(equal(b.max[2], 1));
+}
+
+TEST_CASE("A BVH over no spheres is never hit", "[scene]") {
+    Bvh bvh(std::vector<Sphere>{});
+    REQUIRE(bvh.size() == 0);
+    REQUIRE(!hit(bvh, ray(point(0, 0, -5), vector(0, 0, 1))).has_value());
+}
+
+TEST_CASE("Every BVH leaf is inside its parents' boxes", "[scene]") {
+    std::vector<Sphere> spheres = sphere_cloud(500);
+    Bvh bvh(spheres);
+    const std::vector<BvhNode>& nodes = bvh.nodes();
+    REQUIRE(bvh.size() == spheres.size());
+
+    size_t leaf_spheres = 0;
+    for (size_t n = 0; n < nodes.size(); n++) {
+        const BvhNode& node = nodes[n];
+        if (node.count > 0) {
+            leaf_spheres += node.count;
+            for (size_t i = node.offset; i < node.offset + node.count; i++) {
+                Bounds b = bounds(bvh[i]);
+                for (int k = 0; k < 3; k++) {
+                    REQUIRE(b.min[k] >= node.box.min[k]);
+                    REQUIRE(b.max[k] <= node.box.max[k]);
+                }
+            }
+        }
+    }
+    REQUIRE(leaf_spheres == spheres.size());
+}
+
+TEST_CASE("BVH hits agree with intersecting every sphere", "[scene]") {
+    std::vector<Sphere> spheres = sphere_cloud(500);
+    Bvh bvh(spheres);
+
+    int hits = 0;
+    for (int i = 0; i < 400; i++) {
+        Tuple origin = point(std::sin(i * 0.37) * 3.0, std::cos(i * 0.91) * 3.0, -12);
+        Tuple target = point(std::cos(i * 0.53) * 4.0, std::sin(i * 0.29) * 4.0, (i % 9) - 4.0);
+        Ray r = ray(origin, normalize(subtract(target, origin)));
+
+        std::optional<Intersection> expected = reference_hit(spheres, r);
+        double t = INFINITY;
+        size_t index;
+        bool found = nearest_hit(bvh, r, 0.0, t, index);
+        REQUIRE(found == expected.has_value());
+        if (expected) {
+            REQUIRE(equal(t, expected->t));
+            REQUIRE(&spheres[bvh.source_index(index)] == expected->object);
+            hits++;
+        }
+    }
+    REQUIRE(hits > 50);
+}
+
+TEST_CASE("An empty world is never hit", "[world]") {
+    World w;
+    Ray r = ray(point(0, 0, -5), vector(0, 0, 1));
+    REQUIRE(!closest_hit(w, r).has_value());
+    REQUIRE(!any_hit(w, r));
+}
+
+TEST_CASE("The closest hit in a world respects the t range", "[world]") {
+    World w;
+    Sphere near = sphere();
+    set_transform(near, translation(0, 0, 3));
+    Sphere far = sphere();
+    set_transform(far, translation(0, 0, 10));
+    w.add(far);
+    w.add(near);
+    Ray r = ray(point(0, 0, 0), vector(0, 0, 1));
+
+    std::optional<Intersection> i = closest_hit(w, r);
+    REQUIRE(i.has_value());
+    REQUIRE(equal(i->t, 2.0));
+    REQUIRE(i->object == &w[1]);
+
+    i = closest_hit(w, r, 5.0);
+    REQUIRE(i.has_value());
+    REQUIRE(equal(i->t, 9.0));
+    REQUIRE(i->object == &w[0]);
+
+    REQUIRE(!closest_hit(w, r, 0.0, 1.5).has_value());
+}
+
+TEST_CASE("Any-hit queries stop at t_max", "[world]") {
+    World w;
+    Sphere s = sphere();
+    set_transform(s, translation(0, 0, 5));
+    w.add(s);
+    w.commit();
+    Ray r = ray(point(0, 0, 0), vector(0, 0, 1));
+
+    REQUIRE(any_hit(w, r));
+    REQUIRE(any_hit(w, r, 4.5));
+    REQUIRE(!any_hit(w, r, 3.5));
+}
+
+TEST_CASE("World queries agree with brute force before and after commit", "[world]") {
+    std::vector<Sphere> spheres = sphere_cloud(300);
+    World w;
+    for (size_t i = 0; i < spheres.size(); i++) {
+        w.add(spheres[i]);
+        if (i == 200) {
+            w.commit();  // the remaining spheres stay pending
+        }
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < 200; i++) {
+            Tuple origin = point(std::sin(i * 0.37) * 3.0, std::cos(i * 0.91) * 3.0, -12);
+            Tuple target = point(std::cos(i * 0.53) * 4.0, std::sin(i * 0.29) * 4.0, (i % 9) - 4.0);
+            Ray r = ray(origin, normalize(subtract(target, origin)));
+
+            std::optional<Intersection> expected = reference_hit(spheres, r);
+            std::optional<Intersection> actual = closest_hit(w, r);
+            REQUIRE(actual.has_value() == expected.has_value());
+            REQUIRE(any_hit(w, r) == expected.has_value());
+            if (expected) {
+                REQUIRE(equal(actual->t, expected->t));
+                REQUIRE(actual->object - &w[0] == expected->object - &spheres[0]);
+            }
+        }
+        w.commit();
+    }
+}
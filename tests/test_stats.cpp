@@ -0,0 +1,99 @@
+#include <catch2/catch_test_macros.hpp>
+#include "matrix/matrix.h"
+#include "ray/ray.h"
+#include "render/render.h"
+#include "scene/world.h"
+#include "stats/stats.h"
+#include <thread>
+#include <vector>
+
+TEST_CASE("Counters are cache-line sized", "[stats]") {
+    REQUIRE(alignof(ThreadCounters) == 64);
+    REQUIRE(sizeof(ThreadCounters) % 64 == 0);
+}
+
+TEST_CASE("Scene queries count rays, shape tests and hits", "[stats]") {
+    World world;
+    world.add(sphere());
+    world.commit();
+    take_stats();
+
+    closest_hit(world, ray(point(0, 0, -5), vector(0, 0, 1)));
+    closest_hit(world, ray(point(0, 5, -5), vector(0, 0, 1)));
+    any_hit(world, ray(point(0, 0, -5), vector(0, 0, 1)));
+    Intersections xs = intersect(sphere(), ray(point(0, 0, -5), vector(0, 0, 1)));
+    hit(xs);
+    normal_at(sphere(), point(1, 0, 0));
+    inverse(translation(1, 2, 3));
+
+    RenderStats stats = take_stats();
+    if (STATS_ENABLED) {
+        // The shape-by-shape intersect() and hit() cast no counted ray
+        REQUIRE(stats[Counter::Rays] == 3);
+        REQUIRE(stats[Counter::Hits] == 2);
+        REQUIRE(stats[Counter::Hits] <= stats[Counter::Rays]);
+        // The ray that misses is culled by the hierarchy's bounding box
+        REQUIRE(stats[Counter::ShapeTests] == 3);
+        REQUIRE(stats[Counter::Normals] == 1);
+        // One inversion for each of the two spheres built here, one explicit
+        REQUIRE(stats[Counter::Inverses] == 3);
+    } else {
+        REQUIRE(stats[Counter::Rays] == 0);
+        REQUIRE(stats[Counter::Inverses] == 0);
+    }
+
+    // Taking the statistics resets them
+    REQUIRE(take_stats()[Counter::Rays] == 0);
+}
+
+TEST_CASE("Shadow queries count their shape tests", "[stats]") {
+    World world;
+    world.add(sphere());
+    world.commit();
+    take_stats();
+
+    any_hit(world, ray(point(0, 0, -5), vector(0, 0, 1)));
+    any_hit(world, ray(point(0, 5, -5), vector(0, 0, 1)));
+
+    RenderStats stats = take_stats();
+    if (STATS_ENABLED) {
+        REQUIRE(stats[Counter::Rays] == 2);
+        REQUIRE(stats[Counter::Hits] == 1);
+        REQUIRE(stats[Counter::ShapeTests] >= 1);
+    }
+}
+
+TEST_CASE("Counts from every thread are merged, including finished ones", "[stats]") {
+    take_stats();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 1000; i++) {
+                count(Counter::Rays);
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    count(Counter::Rays, 5);
+
+    RenderStats stats = take_stats();
+    REQUIRE(stats[Counter::Rays] == (STATS_ENABLED ? 4005u : 0u));
+}
+
+TEST_CASE("Rendering and encoding are timed", "[stats]") {
+    Canvas c = canvas(16, 16);
+    take_stats();
+    render(c, [](double, double) { return color(1, 0, 0); });
+    canvas_to_ppm(c);
+
+    RenderStats stats = take_stats();
+    if (STATS_ENABLED) {
+        REQUIRE(stats[Phase::Render] > 0);
+        REQUIRE(stats[Phase::Encode] > 0);
+        REQUIRE(format_stats(stats).find("render") != std::string::npos);
+    } else {
+        REQUIRE(stats[Phase::Render] == 0);
+    }
+}
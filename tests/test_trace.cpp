@@ -0,0 +1,60 @@
+#include <catch2/catch_test_macros.hpp>
+#include "render/render.h"
+#include "stats/trace.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+static size_t occurrences(const std::string& text, const std::string& pattern) {
+    size_t n = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos;
+         pos = text.find(pattern, pos + 1)) {
+        n++;
+    }
+    return n;
+}
+
+TEST_CASE("Scopes record nothing unless tracing", "[trace]") {
+    start_tracing();
+    stop_tracing();
+    {
+        TraceScope scope("untraced");
+    }
+    REQUIRE(trace_json().find("untraced") == std::string::npos);
+}
+
+TEST_CASE("Each rendered tile is one trace event", "[trace]") {
+    Canvas c = canvas(40, 24);
+    RenderOptions options;
+    options.threads = 3;
+    options.tile_size = 8;
+
+    start_tracing();
+    render(c, [](double, double) { return color(0, 1, 0); }, options);
+    canvas_to_ppm(c);
+    stop_tracing();
+
+    std::string json = trace_json();
+    REQUIRE(json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") == 0);
+    REQUIRE(occurrences(json, "\"name\":\"tile\",\"ph\":\"X\"") == 15);
+    REQUIRE(occurrences(json, "\"name\":\"render\",\"ph\":\"X\"") == 1);
+    REQUIRE(occurrences(json, "\"name\":\"encode ppm\",\"ph\":\"X\"") == 1);
+    REQUIRE(json.find("\"args\":{\"x\":32,\"y\":16}") != std::string::npos);
+    REQUIRE(json.substr(json.size() - 3) == "]}\n");
+
+    // A new trace starts empty
+    start_tracing();
+    stop_tracing();
+    REQUIRE(occurrences(trace_json(), "\"ph\":\"X\"") == 0);
+}
+
+TEST_CASE("A full ring keeps the newest events", "[trace]") {
+    start_tracing();
+    std::thread([] {
+        for (size_t i = 0; i < TRACE_BUFFER_EVENTS + 10; i++) {
+            TraceScope scope("event");
+        }
+    }).join();
+    stop_tracing();
+    REQUIRE(occurrences(trace_json(), "\"name\":\"event\"") == TRACE_BUFFER_EVENTS);
+}
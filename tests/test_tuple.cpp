@@ -1,8 +1,12 @@
 #include <catch2/catch_test_macros.hpp>
 #include "tuple/tuple.h"
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
 #include <vector>
+#include <unistd.h>
 
 TEST_CASE("A tuple with w=1.0 is a point", "[tuple]") {
     Tuple a(4.3, -4.2, 3.1, 1.0);
@@ -157,6 +161,25 @@ TEST_CASE("cross product", "[tuple]") {
     REQUIRE(cross(v2, v1) == v4);
 }
 
+TEST_CASE("Single-precision tuples match double precision", "[tuple]") {
+    Tuplef a = vector<float>(1.5f, -2.25f, 3.125f);
+    Tuplef b = point<float>(-0.5f, 4.0f, 0.75f);
+    Tuple da = vector(1.5, -2.25, 3.125);
+    Tuple db = point(-0.5, 4.0, 0.75);
+
+    REQUIRE(b.is_point());
+    REQUIRE(a.is_vector());
+    REQUIRE(equal(add(a, b).x, add(da, db).x));
+    REQUIRE(equal(subtract(b, a).z, subtract(db, da).z));
+    REQUIRE(equal(dot(a, a), dot(da, da)));
+    REQUIRE(equal(magnitude(normalize(a)), 1.0));
+    REQUIRE(equal(cross(a, vector<float>(0, 1, 0)).z, cross(da, vector(0, 1, 0)).z));
+    REQUIRE(blend(color<float>(1, 0.2f, 0.4f), color<float>(0.9f, 1, 0.1f)) == color<float>(0.9f, 0.2f, 0.04f));
+    // The float tolerance is looser than the double one
+    REQUIRE(point<float>(1, 2, 3) == point<float>(1, 2, 3.00005f));
+    REQUIRE(point(1, 2, 3) != point(1, 2, 3.00005));
+}
+
 TEST_CASE("Colors are (red, green, blue) tuples", "[tuple]") {
     Color c = color(-0.5, 0.4, 1.7);
     REQUIRE(equal(c.red(), -0.5));
@@ -194,6 +217,22 @@ TEST_CASE("Writing pixels to a canvas", "[canvas]") {
     REQUIRE(pixel_at(c, 2, 3) == red);
 }
 
+TEST_CASE("Canvas pixels are stored contiguously in row-major order", "[canvas]") {
+    Canvas c = canvas(10, 20);
+    Color red = color(1, 0, 0);
+    Color green = color(0, 1, 0);
+
+    write_pixel(c, 9, 3, red);
+    write_pixel(c, 0, 4, green);
+
+    REQUIRE(c.pixels.size() == 200);
+    REQUIRE(c.stride() == 10);
+    REQUIRE(c.row(4) == c.row(3) + c.stride());
+    REQUIRE(c.row(3)[9] == red);
+    REQUIRE(c.row(3)[10] == green);
+    REQUIRE(c.pixels[3 * 10 + 9] == red);
+}
+
 TEST_CASE("Constructing the PPM header", "[canvas]") {
     Canvas c = canvas(5, 3);
     std::string ppm = canvas_to_ppm(c);
@@ -281,3 +320,209 @@ TEST_CASE("PPM files are terminated by a newline character", "[canvas]") {
 
 
 
+
+TEST_CASE("Constructing a binary (P6) PPM", "[canvas]") {
+    Canvas c = canvas(2, 1);
+    write_pixel(c, 0, 0, color(1.5, 0.5, 0));
+    write_pixel(c, 1, 0, color(-0.5, 0, 1));
+    std::string ppm = canvas_to_ppm(c, PpmFormat::P6);
+
+    std::string header = "P6\n2 1\n255\n";
+    REQUIRE(ppm.size() == header.size() + 6);
+    REQUIRE(ppm.compare(0, header.size(), header) == 0);
+
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(ppm.data()) + header.size();
+    REQUIRE(data[0] == 255);
+    REQUIRE(data[1] == 128);
+    REQUIRE(data[2] == 0);
+    REQUIRE(data[3] == 0);
+    REQUIRE(data[4] == 0);
+    REQUIRE(data[5] == 255);
+}
+
+TEST_CASE("Writing a PPM to a file descriptor matches canvas_to_ppm", "[canvas]") {
+    Canvas c = canvas(300, 80);
+    for (int y = 0; y < c.height; y++) {
+        for (int x = 0; x < c.width; x++) {
+            write_pixel(c, x, y, color(x / 300.0, y / 80.0, 0.5));
+        }
+    }
+
+    for (PpmFormat format : {PpmFormat::P3, PpmFormat::P6}) {
+        std::FILE* file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        REQUIRE(write_ppm(fileno(file), c, format));
+
+        std::string written;
+        std::rewind(file);
+        char buffer[4096];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            written.append(buffer, n);
+        }
+        std::fclose(file);
+
+        REQUIRE(written == canvas_to_ppm(c, format));
+    }
+}
+
+TEST_CASE("A mapped PPM file has the same bytes as canvas_to_ppm", "[canvas]") {
+    Canvas c = canvas(123, 45);
+    for (int y = 0; y < c.height; y++) {
+        for (int x = 0; x < c.width; x++) {
+            write_pixel(c, x, y, color(x / 123.0, y / 45.0, (x * y) % 7 / 6.0));
+        }
+    }
+    char path[] = "/tmp/mapped_ppm_XXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    close(fd);
+
+    for (PpmFormat format : {PpmFormat::P3, PpmFormat::P6}) {
+        for (int threads : {1, 4, 64}) {
+            REQUIRE(save_ppm_mapped(c, path, format, threads));
+
+            std::FILE* file = std::fopen(path, "rb");
+            REQUIRE(file != nullptr);
+            std::string written;
+            char buffer[4096];
+            size_t n;
+            while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+                written.append(buffer, n);
+            }
+            std::fclose(file);
+
+            REQUIRE(written == canvas_to_ppm(c, format));
+        }
+    }
+    unlink(path);
+
+    REQUIRE(save_ppm_mapped(c, "/nonexistent-directory/image.ppm") == false);
+}
+
+TEST_CASE("Decoding an encoded canvas reproduces the PPM", "[canvas]") {
+    Canvas c = canvas(37, 11);
+    for (int y = 0; y < c.height; y++) {
+        for (int x = 0; x < c.width; x++) {
+            write_pixel(c, x, y, color(x / 36.0, y / 10.0, (x + y) % 5 / 4.0));
+        }
+    }
+    for (PpmFormat format : {PpmFormat::P3, PpmFormat::P6}) {
+        std::string ppm = canvas_to_ppm(c, format);
+        Canvas decoded = canvas(1, 1);
+        REQUIRE(parse_ppm(ppm.data(), ppm.size(), decoded));
+        REQUIRE(decoded.width == 37);
+        REQUIRE(decoded.height == 11);
+        REQUIRE(canvas_to_ppm(decoded, format) == ppm);
+        REQUIRE(diff_canvases(c, decoded).identical());
+    }
+}
+
+TEST_CASE("Decoding PPM headers with comments and other maxvals", "[canvas]") {
+    Canvas c = canvas(1, 1);
+
+    std::string plain = "P3\n# a comment\n2 1 # trailing\n15\n15 0 5\n0 15 10\n";
+    REQUIRE(parse_ppm(plain.data(), plain.size(), c));
+    REQUIRE(c.width == 2);
+    REQUIRE(pixel_at(c, 0, 0) == color(1, 0, 1 / 3.0));
+    REQUIRE(pixel_at(c, 1, 0) == color(0, 1, 2 / 3.0));
+
+    std::string wide = "P6 1 1 65535\n";
+    wide += std::string("\xff\xff\x80\x00\x00\x00", 6);
+    REQUIRE(parse_ppm(wide.data(), wide.size(), c));
+    REQUIRE(pixel_at(c, 0, 0) == color(1, 32768 / 65535.0, 0));
+}
+
+TEST_CASE("Malformed PPM data is rejected", "[canvas]") {
+    const char* inputs[] = {
+        "",
+        "P5\n1 1\n255\n0",
+        "P3\n1 1\n255\n0 0",
+        "P3\n1 1\n255\n0 0 256",
+        "P3\n1 1\n0\n0 0 0",
+        "P3\n-1 1\n255\n",
+        "P6\n2 1\n255\nabc",
+    };
+    Canvas c = canvas(3, 2);
+    write_pixel(c, 0, 0, color(1, 1, 1));
+    for (const char* input : inputs) {
+        REQUIRE_FALSE(parse_ppm(input, std::strlen(input), c));
+    }
+    REQUIRE(c.width == 3);
+    REQUIRE(pixel_at(c, 0, 0) == color(1, 1, 1));
+
+    REQUIRE_FALSE(load_ppm("/nonexistent-directory/image.ppm", c));
+}
+
+TEST_CASE("A short PPM claiming a huge image is rejected before allocating", "[canvas]") {
+    char path[] = "/tmp/huge_ppm_XXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    const char header[] = "P6\n65536 65536\n255\n";
+    REQUIRE(write(fd, header, sizeof(header) - 1) == static_cast<ssize_t>(sizeof(header) - 1));
+    close(fd);
+
+    Canvas c = canvas(3, 2);
+    write_pixel(c, 0, 0, color(1, 1, 1));
+    REQUIRE_FALSE(load_ppm(path, c));
+    unlink(path);
+
+    std::string plain = "P3\n65536 65536\n255\n0 0 0\n";
+    REQUIRE_FALSE(parse_ppm(plain.data(), plain.size(), c));
+
+    REQUIRE(c.width == 3);
+    REQUIRE(c.height == 2);
+    REQUIRE(pixel_at(c, 0, 0) == color(1, 1, 1));
+}
+
+TEST_CASE("A saved canvas loads back unchanged", "[canvas]") {
+    Canvas c = canvas(64, 48);
+    for (int y = 0; y < c.height; y++) {
+        for (int x = 0; x < c.width; x++) {
+            write_pixel(c, x, y, color(x / 63.0, 0.5, y / 47.0));
+        }
+    }
+    char path[] = "/tmp/load_ppm_XXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    close(fd);
+
+    for (PpmFormat format : {PpmFormat::P3, PpmFormat::P6}) {
+        save_canvas_to_file(c, path, format);
+        Canvas loaded = canvas(1, 1);
+        REQUIRE(load_ppm(path, loaded));
+        REQUIRE(diff_canvases(c, loaded).identical());
+    }
+    unlink(path);
+}
+
+TEST_CASE("Diffing canvases reports the error and the differing region", "[canvas]") {
+    Canvas a = canvas(10, 8);
+    Canvas b = canvas(10, 8);
+
+    ImageDiff same = diff_canvases(a, b);
+    REQUIRE(same.identical());
+    REQUIRE(same.max_error == 0);
+    REQUIRE(same.max_x < same.min_x);
+
+    write_pixel(b, 2, 5, color(0, 10 / 255.0, 0));
+    write_pixel(b, 7, 3, color(2 / 255.0, 0, 0));
+    ImageDiff diff = diff_canvases(a, b);
+    REQUIRE_FALSE(diff.identical());
+    REQUIRE(diff.differing_pixels == 2);
+    REQUIRE(diff.max_error == 10);
+    REQUIRE(equal(diff.mean_error, 12.0 / 240));
+    REQUIRE(diff.min_x == 2);
+    REQUIRE(diff.min_y == 3);
+    REQUIRE(diff.max_x == 7);
+    REQUIRE(diff.max_y == 5);
+
+    // Within the tolerance a pixel still counts toward the error
+    ImageDiff tolerant = diff_canvases(a, b, 2);
+    REQUIRE(tolerant.differing_pixels == 1);
+    REQUIRE(tolerant.max_error == 10);
+    REQUIRE(tolerant.min_x == 2);
+    REQUIRE(tolerant.max_x == 2);
+
+    REQUIRE_FALSE(diff_canvases(a, canvas(8, 10)).same_size);
+}
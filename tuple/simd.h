@@ -0,0 +1,139 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// Compile-time selection of the SIMD kernels behind the tuple and matrix
+// math. Double tuples use AVX when the target has it (e.g. configured with
+// RAY_TRACER_NATIVE), SSE2 on any other x86-64 build, and the portable
+// scalar code everywhere else. Float tuples fit one SSE register on either
+// x86 path. Only included from .cpp files.
+
+#include <cstddef>
+#include "tuple/tuple.h"
+
+#if defined(__AVX__)
+#define RT_SIMD_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define RT_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(RT_SIMD_AVX) || defined(RT_SIMD_SSE2)
+// Packed kernels exist for both precisions
+#define RT_SIMD 1
+#endif
+
+// The kernels load and store a tuple's x, y, z, w as one packed array
+static_assert(sizeof(Tuple) == 4 * sizeof(double), "Tuple must be four packed doubles");
+static_assert(offsetof(Tuple, w) == 3 * sizeof(double), "Tuple components must be contiguous");
+static_assert(sizeof(Tuplef) == 4 * sizeof(float), "Tuplef must be four packed floats");
+static_assert(offsetof(Tuplef, w) == 3 * sizeof(float), "Tuplef components must be contiguous");
+
+#if defined(RT_SIMD_AVX)
+
+inline __m256d load(const Tuple& t) {
+    return _mm256_loadu_pd(&t.x);
+}
+
+inline Tuple store(__m256d v) {
+    Tuple t;
+    _mm256_storeu_pd(&t.x, v);
+    return t;
+}
+
+// Sum of the four lanes
+inline double horizontal_sum(__m256d v) {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+#elif defined(RT_SIMD_SSE2)
+
+// A tuple as two SSE2 registers: (x, y) and (z, w)
+struct Packed2 {
+    __m128d xy;
+    __m128d zw;
+};
+
+inline Packed2 load(const Tuple& t) {
+    return {_mm_loadu_pd(&t.x), _mm_loadu_pd(&t.z)};
+}
+
+inline Tuple store(const Packed2& v) {
+    Tuple t;
+    _mm_storeu_pd(&t.x, v.xy);
+    _mm_storeu_pd(&t.z, v.zw);
+    return t;
+}
+
+// Sum of the two lanes
+inline double horizontal_sum(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+// Sum of the four lanes, pairing x with z and y with w
+inline double horizontal_sum(const Packed2& v) {
+    return horizontal_sum(_mm_add_pd(v.xy, v.zw));
+}
+
+#endif
+
+#if defined(RT_SIMD)
+
+inline __m128 load(const Tuplef& t) {
+    return _mm_loadu_ps(&t.x);
+}
+
+inline Tuplef store(__m128 v) {
+    Tuplef t;
+    _mm_storeu_ps(&t.x, v);
+    return t;
+}
+
+// Sum of the four lanes
+inline float horizontal_sum(__m128 v) {
+    __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+}
+
+// Lane-wise arithmetic overloaded on the register type, so the tuple
+// kernels are written once for both precisions
+namespace simd {
+
+#if defined(RT_SIMD_AVX)
+inline __m256d add(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+inline __m256d sub(__m256d a, __m256d b) { return _mm256_sub_pd(a, b); }
+inline __m256d mul(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+inline __m256d mul(__m256d a, double s) { return _mm256_mul_pd(a, _mm256_set1_pd(s)); }
+inline __m256d div(__m256d a, double s) { return _mm256_div_pd(a, _mm256_set1_pd(s)); }
+#else
+inline Packed2 add(const Packed2& a, const Packed2& b) {
+    return {_mm_add_pd(a.xy, b.xy), _mm_add_pd(a.zw, b.zw)};
+}
+inline Packed2 sub(const Packed2& a, const Packed2& b) {
+    return {_mm_sub_pd(a.xy, b.xy), _mm_sub_pd(a.zw, b.zw)};
+}
+inline Packed2 mul(const Packed2& a, const Packed2& b) {
+    return {_mm_mul_pd(a.xy, b.xy), _mm_mul_pd(a.zw, b.zw)};
+}
+inline Packed2 mul(const Packed2& a, double s) {
+    __m128d v = _mm_set1_pd(s);
+    return {_mm_mul_pd(a.xy, v), _mm_mul_pd(a.zw, v)};
+}
+inline Packed2 div(const Packed2& a, double s) {
+    __m128d v = _mm_set1_pd(s);
+    return {_mm_div_pd(a.xy, v), _mm_div_pd(a.zw, v)};
+}
+#endif
+
+inline __m128 add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+inline __m128 sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+inline __m128 mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+inline __m128 mul(__m128 a, float s) { return _mm_mul_ps(a, _mm_set1_ps(s)); }
+inline __m128 div(__m128 a, float s) { return _mm_div_ps(a, _mm_set1_ps(s)); }
+
+} // namespace simd
+
+#endif
+
+#endif // SIMD_H
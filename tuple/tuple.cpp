@@ -1,44 +1,55 @@
 #include "tuple.h"
-#include <sstream>
+#include "simd.h"
+#include "stats/stats.h"
+#include "stats/trace.h"
 #include <algorithm>
-#include <fstream>
-
-Tuple point(double x, double y, double z) {
-    return Tuple(x, y, z, 1.0);
-}
-
-Tuple vector(double x, double y, double z) {
-    return Tuple(x, y, z, 0.0);
-}
-
-Color color(double red, double green, double blue) {
-    return Color(red, green, blue);
-}
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
 
 bool equal(double a, double b) {
     return std::abs(a - b) <= EPSILON;
 }
 
-bool equal(const Tuple& a, const Tuple& b) {
-    return std::abs(a.x - b.x) < EPSILON &&
-           std::abs(a.y - b.y) < EPSILON &&
-           std::abs(a.z - b.z) < EPSILON &&
-           std::abs(a.w - b.w) < EPSILON;
+template <typename T>
+bool equal(const TupleT<T>& a, const TupleT<T>& b) {
+    return std::abs(a.x - b.x) < Precision<T>::epsilon &&
+           std::abs(a.y - b.y) < Precision<T>::epsilon &&
+           std::abs(a.z - b.z) < Precision<T>::epsilon &&
+           std::abs(a.w - b.w) < Precision<T>::epsilon;
 }
 
-Tuple add(const Tuple& a, const Tuple& b) {
+template <typename T>
+TupleT<T> add(const TupleT<T>& a, const TupleT<T>& b) {
     // point + vector = point
     // point + point is not valid
-    Tuple tuple(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); 
+#if defined(RT_SIMD)
+    return store(simd::add(load(a), load(b)));
+#else
+    TupleT<T> tuple(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); 
     return tuple; 
+#endif
 }
 
-Tuple subtract(const Tuple& a, const Tuple& b) {
-    Tuple tuple(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); 
+template <typename T>
+TupleT<T> subtract(const TupleT<T>& a, const TupleT<T>& b) {
+#if defined(RT_SIMD)
+    return store(simd::sub(load(a), load(b)));
+#else
+    TupleT<T> tuple(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); 
     return tuple; 
+#endif
 }
 
-Tuple negate(Tuple& a) { 
+template <typename T>
+TupleT<T> negate(TupleT<T>& a) { 
     a.x = -a.x; 
     a.y = -a.y; 
     a.z = -a.z; 
@@ -47,45 +58,93 @@ Tuple negate(Tuple& a) {
     return a; 
 } 
 
-Tuple multiply(Tuple&a, double scale) {
+template <typename T>
+TupleT<T> multiply(TupleT<T>& a, NoDeduce<T> scale) {
+#if defined(RT_SIMD)
+    a = store(simd::mul(load(a), scale));
+#else
     a.x *= scale; 
     a.y *= scale; 
     a.z *= scale; 
     a.w *= scale; 
+#endif
 
     return a; 
 }
 
-double magnitude(const Tuple& a) {
-    return std::sqrt(std::pow(a.x, 2.0) + std::pow(a.y, 2.0) + std::pow(a.z, 2.0) + std::pow(a.w, 2.0));
+template <typename T>
+T magnitude(const TupleT<T>& a) {
+    return std::sqrt(dot(a, a));
 }
 
-Tuple normalize(const Tuple& a) {
-    double mag = magnitude(a);
-    return Tuple(a.x / mag, a.y / mag, a.z / mag, a.w / mag);
+template <typename T>
+TupleT<T> normalize(const TupleT<T>& a) {
+    T mag = magnitude(a);
+#if defined(RT_SIMD)
+    return store(simd::div(load(a), mag));
+#else
+    return TupleT<T>(a.x / mag, a.y / mag, a.z / mag, a.w / mag);
+#endif
 }
 
-double dot(const Tuple&a, const Tuple& b) {
+template <typename T>
+T dot(const TupleT<T>& a, const TupleT<T>& b) {
+#if defined(RT_SIMD)
+    return horizontal_sum(simd::mul(load(a), load(b)));
+#else
     return (a.x * b.x) + (a.y * b.y) + (a.z * b.z) + (a.w * b.w);
+#endif
 }
 
-Tuple cross(const Tuple&a, const Tuple& b) {
-    Tuple v = vector((a.y * b.z) - (a.z * b.y), 
-                     (a.z * b.x) - (a.x * b.z),
-                     (a.x * b.y) - (a.y * b.x));
+template <typename T>
+TupleT<T> cross(const TupleT<T>& a, const TupleT<T>& b) {
+    TupleT<T> v = vector<T>((a.y * b.z) - (a.z * b.y), 
+                            (a.z * b.x) - (a.x * b.z),
+                            (a.x * b.y) - (a.y * b.x));
     return v; 
 }
 
-Color blend(const Color& c1, const Color& c2) {
+template <typename T>
+TupleT<T> reflect(const TupleT<T>& in, const TupleT<T>& normal) {
+    TupleT<T> scaled_normal = normal;
+    multiply(scaled_normal, 2 * dot(in, normal)); 
+    return subtract(in, scaled_normal);
+}
+
+template <typename T>
+ColorT<T> blend(const ColorT<T>& c1, const ColorT<T>& c2) {
     // Hadamard product
-    double r = c1.red() * c2.red(); 
-    double g = c1.green() * c2.green(); 
-    double b = c1.blue() * c2.blue(); 
+#if defined(RT_SIMD)
+    TupleT<T> product = store(simd::mul(load(c1), load(c2)));
+    return ColorT<T>(product.x, product.y, product.z);
+#else
+    T r = c1.red() * c2.red(); 
+    T g = c1.green() * c2.green(); 
+    T b = c1.blue() * c2.blue(); 
 
-    Color result(r, g, b); 
+    ColorT<T> result(r, g, b); 
     return result; 
+#endif
 }
 
+#define INSTANTIATE_TUPLE_OPERATIONS(T) \
+    template bool equal(const TupleT<T>&, const TupleT<T>&); \
+    template TupleT<T> add(const TupleT<T>&, const TupleT<T>&); \
+    template TupleT<T> subtract(const TupleT<T>&, const TupleT<T>&); \
+    template TupleT<T> negate(TupleT<T>&); \
+    template TupleT<T> multiply(TupleT<T>&, T); \
+    template T magnitude(const TupleT<T>&); \
+    template TupleT<T> normalize(const TupleT<T>&); \
+    template T dot(const TupleT<T>&, const TupleT<T>&); \
+    template TupleT<T> cross(const TupleT<T>&, const TupleT<T>&); \
+    template TupleT<T> reflect(const TupleT<T>&, const TupleT<T>&); \
+    template ColorT<T> blend(const ColorT<T>&, const ColorT<T>&);
+
+INSTANTIATE_TUPLE_OPERATIONS(float)
+INSTANTIATE_TUPLE_OPERATIONS(double)
+
+#undef INSTANTIATE_TUPLE_OPERATIONS
+
 // Canvas functions
 Canvas canvas(int width, int height) {
     return Canvas(width, height);
@@ -93,95 +152,453 @@ Canvas canvas(int width, int height) {
 
 void write_pixel(Canvas& c, int x, int y, const Color& color) {
     if (x >= 0 && x < c.width && y >= 0 && y < c.height) {
-        c.pixels[y][x] = color;
+        c.row(y)[x] = color;
     }
 }
 
 Color pixel_at(const Canvas& c, int x, int y) {
     if (x >= 0 && x < c.width && y >= 0 && y < c.height) {
-        return c.pixels[y][x];
+        return c.row(y)[x];
     }
     return color(0, 0, 0); // Return black for out-of-bounds
 }
 
-std::string canvas_to_ppm(const Canvas& c) {
-    std::ostringstream ppm;
-    
-    // Header
-    ppm << "P3\n";
-    ppm << c.width << " " << c.height << "\n";
-    ppm << "255\n";
-    
-    // Pixel data with line length limit (70 characters)
-    const int MAX_LINE_LENGTH = 70;
-    std::string current_line;
-    
-    for (int y = 0; y < c.height; y++) {
-        for (int x = 0; x < c.width; x++) {
-            const Color& pixel = c.pixels[y][x];
-            
-            // Scale and clamp color values to 0-255
-            int r = static_cast<int>(std::round(std::max(0.0, std::min(1.0, pixel.red())) * 255.0));
-            int g = static_cast<int>(std::round(std::max(0.0, std::min(1.0, pixel.green())) * 255.0));
-            int b = static_cast<int>(std::round(std::max(0.0, std::min(1.0, pixel.blue())) * 255.0));
-            
-            // Format the RGB values as individual components
-            std::ostringstream r_str, g_str, b_str;
-            r_str << r;
-            g_str << g;
-            b_str << b;
-            std::string r_val = r_str.str();
-            std::string g_val = g_str.str();
-            std::string b_val = b_str.str();
-            
-            // Add each component, checking line length
-            // Add red component
-            if (!current_line.empty()) {
-                if (current_line.length() + 1 + r_val.length() > MAX_LINE_LENGTH) {
-                    ppm << current_line << "\n";
-                    current_line = r_val;
+// PPM encoding
+
+// Plain PPM lines must not exceed 70 characters
+static const int MAX_LINE_LENGTH = 70;
+
+// Buffer size used when streaming an encoded canvas to a file descriptor
+static const size_t WRITE_BUFFER_SIZE = 1 << 16;
+
+// Scale and clamp a color component to 0-255
+static int to_byte(double v) {
+    return static_cast<int>(std::round(std::max(0.0, std::min(1.0, v)) * 255.0));
+}
+
+// Writes the decimal digits of n (0-255) to out and returns their count
+static int format_byte(char* out, int n) {
+    if (n >= 100) {
+        out[0] = static_cast<char>('0' + n / 100);
+        out[1] = static_cast<char>('0' + (n / 10) % 10);
+        out[2] = static_cast<char>('0' + n % 10);
+        return 3;
+    }
+    if (n >= 10) {
+        out[0] = static_cast<char>('0' + n / 10);
+        out[1] = static_cast<char>('0' + n % 10);
+        return 2;
+    }
+    out[0] = static_cast<char>('0' + n);
+    return 1;
+}
+
+// Upper bound on the encoded size of the header
+static size_t max_header_bytes() {
+    // "P3\n" + two ints of up to 11 chars + " " + "\n" + "255\n"
+    return 3 + 11 + 1 + 11 + 1 + 4;
+}
+
+// Upper bound on the encoded size of one row: P3 spends at most three
+// digits plus one separator per component, P6 exactly one byte
+static size_t max_row_bytes(int width, PpmFormat format) {
+    size_t components = 3 * static_cast<size_t>(width);
+    return format == PpmFormat::P6 ? components : components * 4;
+}
+
+static size_t encode_header(int width, int height, PpmFormat format, char* out) {
+    int n = std::snprintf(out, max_header_bytes() + 1, "%s\n%d %d\n255\n",
+                          format == PpmFormat::P6 ? "P6" : "P3", width, height);
+    return static_cast<size_t>(n);
+}
+
+// Encodes one plain (P3) row. With Write false nothing is stored and out
+// may be null; the return value is still the exact encoded length, which
+// lets a writer lay out the output before encoding it.
+template <bool Write>
+static size_t encode_p3_row(const Color* row, int width, char* out) {
+    // Components are separated by spaces; a line that would grow past
+    // MAX_LINE_LENGTH is broken before the next component. Every row ends
+    // its last line.
+    size_t n = 0;
+    int line_length = 0;
+    for (int x = 0; x < width; x++) {
+        int components[3] = {
+            to_byte(row[x].red()), to_byte(row[x].green()), to_byte(row[x].blue())
+        };
+        for (int value : components) {
+            char digits[3];
+            int length = format_byte(digits, value);
+            if (line_length > 0) {
+                char separator = ' ';
+                if (line_length + 1 + length > MAX_LINE_LENGTH) {
+                    separator = '\n';
+                    line_length = 0;
                 } else {
-                    current_line += " " + r_val;
+                    line_length++;
                 }
-            } else {
-                current_line = r_val;
+                if (Write) {
+                    out[n] = separator;
+                }
+                n++;
             }
-            
-            // Add green component
-            if (current_line.length() + 1 + g_val.length() > MAX_LINE_LENGTH) {
-                ppm << current_line << "\n";
-                current_line = g_val;
-            } else {
-                current_line += " " + g_val;
+            if (Write) {
+                for (int i = 0; i < length; i++) {
+                    out[n + i] = digits[i];
+                }
             }
-            
-            // Add blue component
-            if (current_line.length() + 1 + b_val.length() > MAX_LINE_LENGTH) {
-                ppm << current_line << "\n";
-                current_line = b_val;
+            n += length;
+            line_length += length;
+        }
+    }
+    if (line_length > 0) {
+        if (Write) {
+            out[n] = '\n';
+        }
+        n++;
+    }
+    return n;
+}
+
+// Encodes one row of width pixels at out and returns the number of bytes
+// written
+static size_t encode_row(const Color* row, int width, PpmFormat format, char* out) {
+    if (format == PpmFormat::P3) {
+        return encode_p3_row<true>(row, width, out);
+    }
+    char* start = out;
+    for (int x = 0; x < width; x++) {
+        *out++ = static_cast<char>(to_byte(row[x].red()));
+        *out++ = static_cast<char>(to_byte(row[x].green()));
+        *out++ = static_cast<char>(to_byte(row[x].blue()));
+    }
+    return static_cast<size_t>(out - start);
+}
+
+// Exact encoded length of one row
+static size_t row_length(const Color* row, int width, PpmFormat format) {
+    if (format == PpmFormat::P3) {
+        return encode_p3_row<false>(row, width, nullptr);
+    }
+    return 3 * static_cast<size_t>(width);
+}
+
+// Writes all of data to fd, retrying on short writes and EINTR
+static bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::string canvas_to_ppm(const Canvas& c, PpmFormat format) {
+    PhaseTimer timer(Phase::Encode);
+    TraceScope trace("encode ppm");
+    // Encode straight into the string's storage, sized for the worst case
+    std::string ppm(max_header_bytes() + 1 +
+                    max_row_bytes(c.width, format) * static_cast<size_t>(c.height), '\0');
+    size_t length = encode_header(c.width, c.height, format, &ppm[0]);
+    for (int y = 0; y < c.height; y++) {
+        length += encode_row(c.row(y), c.width, format, &ppm[length]);
+    }
+    ppm.resize(length);
+    return ppm;
+}
+
+bool write_ppm(int fd, const Canvas& c, PpmFormat format) {
+    return write_ppm_rows(fd, c.width, c.height, format, [&](int y) { return c.row(y); });
+}
+
+bool write_ppm_rows(int fd, int width, int height, PpmFormat format,
+                    const std::function<const Color*(int y)>& row) {
+    PhaseTimer timer(Phase::Encode);
+    TraceScope trace("write ppm");
+    // One reusable buffer, flushed whenever the next row might not fit
+    size_t row_bytes = max_row_bytes(width, format);
+    std::vector<char> buffer(std::max(WRITE_BUFFER_SIZE, max_header_bytes() + 1 + row_bytes));
+    size_t used = encode_header(width, height, format, buffer.data());
+
+    for (int y = 0; y < height; y++) {
+        if (used + row_bytes > buffer.size()) {
+            if (!write_all(fd, buffer.data(), used)) {
+                return false;
+            }
+            used = 0;
+        }
+        used += encode_row(row(y), width, format, buffer.data() + used);
+    }
+    return write_all(fd, buffer.data(), used);
+}
+
+void save_canvas_to_file(const Canvas& c, const std::string& filename, PpmFormat format) {
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    write_ppm(fd, c, format);
+    ::close(fd);
+}
+
+// Calls work(begin, end) on `threads` threads for contiguous, equal ranges
+// of [0, count); the calling thread takes the first range
+static void parallel_ranges(int count, int threads,
+                            const std::function<void(int begin, int end)>& work) {
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++) {
+        pool.emplace_back(work, count * t / threads, count * (t + 1) / threads);
+    }
+    work(0, count / threads);
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+}
+
+bool save_ppm_mapped(const Canvas& c, const std::string& filename, PpmFormat format, int threads) {
+    PhaseTimer timer(Phase::Encode);
+    TraceScope trace("write ppm (mapped)");
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    threads = std::max(1, std::min(threads, c.height));
+
+    // Lay the file out first: the header, then each row at a known offset
+    char header[32];
+    size_t header_length = encode_header(c.width, c.height, format, header);
+    std::vector<size_t> offsets(static_cast<size_t>(c.height) + 1, 0);
+    parallel_ranges(c.height, threads, [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            offsets[y + 1] = row_length(c.row(y), c.width, format);
+        }
+    });
+    offsets[0] = header_length;
+    for (int y = 0; y < c.height; y++) {
+        offsets[y + 1] += offsets[y];
+    }
+    size_t size = offsets[c.height];
+
+    int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    void* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    // Each thread encodes its rows in place; the ranges never overlap
+    char* out = static_cast<char*>(mapping);
+    std::memcpy(out, header, header_length);
+    parallel_ranges(c.height, threads, [&](int begin, int end) {
+        TraceScope rows("encode rows", 0, begin);
+        for (int y = begin; y < end; y++) {
+            encode_row(c.row(y), c.width, format, out + offsets[y]);
+        }
+    });
+    return ::munmap(mapping, size) == 0;
+}
+
+// PPM decoding
+
+// Cursor over the bytes of an encoded image; every read is bounds checked
+struct PpmReader {
+    const unsigned char* data;
+    size_t size;
+    size_t pos;
+
+    bool at_end() const { return pos >= size; }
+
+    static bool is_space(unsigned char ch) {
+        return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t' || ch == '\v' || ch == '\f';
+    }
+
+    // Skips whitespace and, in the header, '#' comments up to end of line
+    void skip_space(bool comments) {
+        while (pos < size) {
+            if (is_space(data[pos])) {
+                pos++;
+            } else if (comments && data[pos] == '#') {
+                while (pos < size && data[pos] != '\n') {
+                    pos++;
+                }
             } else {
-                current_line += " " + b_val;
+                break;
             }
         }
-        
-        // End of row - output current line and start new line
-        if (!current_line.empty()) {
-            ppm << current_line << "\n";
-            current_line.clear();
+    }
+
+    // Reads an unsigned decimal integer no larger than limit
+    bool read_int(int limit, int& value, bool comments) {
+        skip_space(comments);
+        if (pos >= size || data[pos] < '0' || data[pos] > '9') {
+            return false;
         }
+        long long n = 0;
+        while (pos < size && data[pos] >= '0' && data[pos] <= '9') {
+            n = n * 10 + (data[pos] - '0');
+            if (n > limit) {
+                return false;
+            }
+            pos++;
+        }
+        value = static_cast<int>(n);
+        return true;
     }
-    
-    // Ensure file ends with newline (if current_line is empty, we already have a newline from last row)
-    // But we need to make sure there's always a trailing newline
-    return ppm.str();
+};
+
+bool parse_ppm(const char* data, size_t size, Canvas& out) {
+    PpmReader in{reinterpret_cast<const unsigned char*>(data), size, 0};
+    if (size < 2 || data[0] != 'P' || (data[1] != '3' && data[1] != '6')) {
+        return false;
+    }
+    bool binary = data[1] == '6';
+    in.pos = 2;
+
+    int width = 0;
+    int height = 0;
+    int maxval = 0;
+    const int max_dimension = 1 << 16;
+    if (!in.read_int(max_dimension, width, true) || !in.read_int(max_dimension, height, true) ||
+        !in.read_int(65535, maxval, true) || maxval == 0) {
+        return false;
+    }
+    if (height > 0 && static_cast<size_t>(width) > SIZE_MAX / static_cast<size_t>(height)) {
+        return false;
+    }
+    size_t pixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+
+    // Check the header against the data before allocating, so a short file
+    // claiming a huge image is rejected without building the canvas
+    size_t bytes = maxval > 255 ? 2 : 1;
+    if (binary) {
+        // Exactly one whitespace byte separates the header from the raster;
+        // components are one byte, or two (big-endian) when maxval > 255
+        if (in.at_end() || !PpmReader::is_space(in.data[in.pos])) {
+            return false;
+        }
+        in.pos++;
+        if ((in.size - in.pos) / (3 * bytes) < pixels) {
+            return false;
+        }
+    } else if ((in.size - in.pos) / 6 < pixels) {
+        // Each plain pixel takes at least three digits and three separators
+        // (the first separator being the one after maxval)
+        return false;
+    }
+    if (pixels > std::vector<Color>().max_size()) {
+        return false;
+    }
+
+    Canvas result(width, height);
+    double scale = 1.0 / maxval;
+
+    if (binary) {
+        const unsigned char* raster = in.data + in.pos;
+        for (size_t i = 0; i < pixels; i++) {
+            int rgb[3];
+            for (int k = 0; k < 3; k++) {
+                const unsigned char* p = raster + (3 * i + k) * bytes;
+                rgb[k] = bytes == 1 ? p[0] : (p[0] << 8) | p[1];
+                if (rgb[k] > maxval) {
+                    return false;
+                }
+            }
+            result.pixels[i] = color(rgb[0] * scale, rgb[1] * scale, rgb[2] * scale);
+        }
+    } else {
+        for (size_t i = 0; i < pixels; i++) {
+            int rgb[3];
+            for (int k = 0; k < 3; k++) {
+                if (!in.read_int(maxval, rgb[k], false)) {
+                    return false;
+                }
+            }
+            result.pixels[i] = color(rgb[0] * scale, rgb[1] * scale, rgb[2] * scale);
+        }
+    }
+
+    out = std::move(result);
+    return true;
 }
 
-void save_canvas_to_file(const Canvas& c, const std::string& filename) {
-    std::string ppm = canvas_to_ppm(c);
-    std::ofstream file(filename);
-    if (file.is_open()) {
-        file << ppm;
-        file.close();
+bool load_ppm(const std::string& filename, Canvas& out) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
     }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    // The file is read front to back exactly once
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+    bool ok = parse_ppm(static_cast<const char*>(mapping), size, out);
+    ::munmap(mapping, size);
+    return ok;
 }
 
+ImageDiff diff_canvases(const Canvas& a, const Canvas& b, int tolerance) {
+    ImageDiff diff;
+    if (a.width != b.width || a.height != b.height) {
+        return diff;
+    }
+    diff.same_size = true;
+    diff.min_x = a.width;
+    diff.min_y = a.height;
+
+    long long total_error = 0;
+    for (int y = 0; y < a.height; y++) {
+        const Color* row_a = a.row(y);
+        const Color* row_b = b.row(y);
+        // Regression checks mostly compare identical images; bitwise equal
+        // rows cannot differ once encoded
+        if (std::memcmp(row_a, row_b, a.stride() * sizeof(Color)) == 0) {
+            continue;
+        }
+        for (int x = 0; x < a.width; x++) {
+            int errors[3] = {
+                std::abs(to_byte(row_a[x].red()) - to_byte(row_b[x].red())),
+                std::abs(to_byte(row_a[x].green()) - to_byte(row_b[x].green())),
+                std::abs(to_byte(row_a[x].blue()) - to_byte(row_b[x].blue()))
+            };
+            int worst = std::max(errors[0], std::max(errors[1], errors[2]));
+            total_error += errors[0] + errors[1] + errors[2];
+            diff.max_error = std::max(diff.max_error, worst);
+            if (worst > tolerance) {
+                diff.differing_pixels++;
+                diff.min_x = std::min(diff.min_x, x);
+                diff.min_y = std::min(diff.min_y, y);
+                diff.max_x = std::max(diff.max_x, x);
+                diff.max_y = std::max(diff.max_y, y);
+            }
+        }
+    }
+    size_t components = 3 * static_cast<size_t>(a.width) * static_cast<size_t>(a.height);
+    if (components > 0) {
+        diff.mean_error = static_cast<double>(total_error) / static_cast<double>(components);
+    }
+    if (diff.differing_pixels == 0) {
+        diff.min_x = 0;
+        diff.min_y = 0;
+    }
+    return diff;
+}
@@ -2,94 +2,218 @@
 #define TUPLE_H
 
 #include <cmath>
+#include <functional>
 #include <vector>
 #include <string>
 
-constexpr double EPSILON = 0.00001;
+// Tolerance for floating point comparisons at each supported precision
+template <typename T>
+struct Precision;
 
-class Tuple {
+template <>
+struct Precision<double> {
+    static constexpr double epsilon = 0.00001;
+};
+
+template <>
+struct Precision<float> {
+    static constexpr float epsilon = 0.0001f;
+};
+
+constexpr double EPSILON = Precision<double>::epsilon;
+
+// Wraps T in a non-deduced context, so factories like point(1, 2, 3) default
+// to double instead of deducing int, while point<float>(...) still works
+template <typename T>
+struct NonDeduced {
+    using type = T;
+};
+
+template <typename T>
+using NoDeduce = typename NonDeduced<T>::type;
+
+// Absolute value usable in constant expressions (std::abs is not constexpr)
+template <typename T>
+constexpr T absolute(T v) {
+    return v < 0 ? -v : v;
+}
+
+template <typename T>
+class TupleT {
 public:
-    double x, y, z, w;
+    T x, y, z, w;
 
-    Tuple(double x = 0.0, double y = 0.0, double z = 0.0, double w = 0.0)
+    constexpr TupleT(T x = 0, T y = 0, T z = 0, T w = 0)
         : x(x), y(y), z(z), w(w) {}
 
-    bool is_point() const {
-        return std::abs(w - 1.0) < EPSILON;
+    constexpr bool is_point() const {
+        return absolute(w - 1) < Precision<T>::epsilon;
     }
 
-    bool is_vector() const {
-        return std::abs(w - 0.0) < EPSILON;
+    constexpr bool is_vector() const {
+        return absolute(w - 0) < Precision<T>::epsilon;
     }
 
-    bool operator==(const Tuple& other) const {
-        return std::abs(x - other.x) < EPSILON &&
-               std::abs(y - other.y) < EPSILON &&
-               std::abs(z - other.z) < EPSILON &&
-               std::abs(w - other.w) < EPSILON;
+    constexpr bool operator==(const TupleT& other) const {
+        return absolute(x - other.x) < Precision<T>::epsilon &&
+               absolute(y - other.y) < Precision<T>::epsilon &&
+               absolute(z - other.z) < Precision<T>::epsilon &&
+               absolute(w - other.w) < Precision<T>::epsilon;
     }
 
-    bool operator!=(const Tuple& other) const {
+    constexpr bool operator!=(const TupleT& other) const {
         return !(*this == other);
     }
 };
 
 // Color class built on top of Tuple
-class Color : public Tuple {
+template <typename T>
+class ColorT : public TupleT<T> {
 public:
-    Color(double red = 0.0, double green = 0.0, double blue = 0.0)
-        : Tuple(red, green, blue, 0.0) {}
+    constexpr ColorT(T red = 0, T green = 0, T blue = 0)
+        : TupleT<T>(red, green, blue, 0) {}
 
     // Accessors that return references to x, y, z as red, green, blue
-    double& red() { return x; }
-    double& green() { return y; }
-    double& blue() { return z; }
+    constexpr T& red() { return this->x; }
+    constexpr T& green() { return this->y; }
+    constexpr T& blue() { return this->z; }
     
-    const double& red() const { return x; }
-    const double& green() const { return y; }
-    const double& blue() const { return z; }
+    constexpr const T& red() const { return this->x; }
+    constexpr const T& green() const { return this->y; }
+    constexpr const T& blue() const { return this->z; }
 };
 
-// Canvas class for storing pixels
+using Tuple = TupleT<double>;
+using Color = ColorT<double>;
+// Single precision, for previews and wider SIMD
+using Tuplef = TupleT<float>;
+using Colorf = ColorT<float>;
+
+// Canvas class for storing pixels in one contiguous row-major buffer.
+// Row y starts at pixels[y * stride()], so encoders and renderers can walk
+// a row (or the whole image) linearly through row().
 class Canvas {
 public:
     int width;
     int height;
-    std::vector<std::vector<Color>> pixels;
+    std::vector<Color> pixels;
 
     Canvas(int width, int height)
-        : width(width), height(height), pixels(height, std::vector<Color>(width, Color(0, 0, 0))) {}
+        : width(width), height(height),
+          pixels(static_cast<size_t>(width) * static_cast<size_t>(height), Color(0, 0, 0)) {}
+
+    // Distance in pixels between the starts of consecutive rows
+    size_t stride() const { return static_cast<size_t>(width); }
+
+    // Pointer to the first pixel of row y (no bounds checking)
+    Color* row(int y) { return pixels.data() + y * stride(); }
+    const Color* row(int y) const { return pixels.data() + y * stride(); }
 };
 
-// Factory functions
-Tuple point(double x, double y, double z);
-Tuple vector(double x, double y, double z);
-Color color(double red, double green, double blue);
+// Factory functions; double unless a precision is given, e.g. point<float>.
+// Usable in constant expressions.
+template <typename T = double>
+constexpr TupleT<T> point(NoDeduce<T> x, NoDeduce<T> y, NoDeduce<T> z) {
+    return TupleT<T>(x, y, z, 1);
+}
+
+template <typename T = double>
+constexpr TupleT<T> vector(NoDeduce<T> x, NoDeduce<T> y, NoDeduce<T> z) {
+    return TupleT<T>(x, y, z, 0);
+}
+
+template <typename T = double>
+constexpr ColorT<T> color(NoDeduce<T> red, NoDeduce<T> green, NoDeduce<T> blue) {
+    return ColorT<T>(red, green, blue);
+}
 
 // Floating point comparison utility
 bool equal(double a, double b);
 
 // Tuple comparison function
-bool equal(const Tuple& a, const Tuple& b);
-
-// Tuple Operations
-Tuple add(const Tuple& a, const Tuple& b); 
-Tuple subtract(const Tuple& a, const Tuple& b); 
-Tuple negate(Tuple& a); 
-Tuple multiply(Tuple& a, double scale); 
-double magnitude(const Tuple& a); 
-Tuple normalize(const Tuple& a); 
-double dot(const Tuple&a, const Tuple& b); 
-Tuple cross(const Tuple&a, const Tuple& b); 
-Tuple reflect(const Tuple& in, const Tuple& normal);
-Color blend(const Color& c1, const Color& c2);
+template <typename T>
+bool equal(const TupleT<T>& a, const TupleT<T>& b);
+
+// Tuple Operations, instantiated for float and double
+template <typename T>
+TupleT<T> add(const TupleT<T>& a, const TupleT<T>& b); 
+template <typename T>
+TupleT<T> subtract(const TupleT<T>& a, const TupleT<T>& b); 
+template <typename T>
+TupleT<T> negate(TupleT<T>& a); 
+template <typename T>
+TupleT<T> multiply(TupleT<T>& a, NoDeduce<T> scale); 
+template <typename T>
+T magnitude(const TupleT<T>& a); 
+template <typename T>
+TupleT<T> normalize(const TupleT<T>& a); 
+template <typename T>
+T dot(const TupleT<T>& a, const TupleT<T>& b); 
+template <typename T>
+TupleT<T> cross(const TupleT<T>& a, const TupleT<T>& b); 
+template <typename T>
+TupleT<T> reflect(const TupleT<T>& in, const TupleT<T>& normal);
+template <typename T>
+ColorT<T> blend(const ColorT<T>& c1, const ColorT<T>& c2);
 
 // Canvas functions
 Canvas canvas(int width, int height);
 void write_pixel(Canvas& c, int x, int y, const Color& color);
 Color pixel_at(const Canvas& c, int x, int y);
-std::string canvas_to_ppm(const Canvas& c);
-void save_canvas_to_file(const Canvas& c, const std::string& filename); 
+
+// PPM encoding: P3 is the plain-text format, P6 the binary one
+enum class PpmFormat { P3, P6 };
+
+std::string canvas_to_ppm(const Canvas& c, PpmFormat format = PpmFormat::P3);
+// Streams the encoded canvas to an open file descriptor through a fixed-size
+// buffer; returns false if a write fails
+bool write_ppm(int fd, const Canvas& c, PpmFormat format = PpmFormat::P3);
+// Same, for images not stored as a Canvas: row(y) returns the width pixels
+// of row y, which must stay valid until the next call
+bool write_ppm_rows(int fd, int width, int height, PpmFormat format,
+                    const std::function<const Color*(int y)>& row);
+void save_canvas_to_file(const Canvas& c, const std::string& filename,
+                         PpmFormat format = PpmFormat::P3);
+// Writes the PPM without an intermediate buffer: the exact size is computed
+// first (a measuring pass for P3), the file is sized and mapped, and
+// `threads` threads (0 = one per hardware thread) encode disjoint row
+// ranges straight into the mapping. Same bytes as canvas_to_ppm; returns
+// false if the file cannot be created or mapped.
+bool save_ppm_mapped(const Canvas& c, const std::string& filename,
+                     PpmFormat format = PpmFormat::P3, int threads = 0);
+
+// PPM decoding. Reads P3 or P6 with any maxval up to 65535 (components are
+// scaled to 0-1) and comments in the header. On failure the output canvas
+// is left untouched.
+bool parse_ppm(const char* data, size_t size, Canvas& out);
+// Maps the file and parses it in place; returns false if it cannot be read
+// or is not a valid PPM
+bool load_ppm(const std::string& filename, Canvas& out);
+
+// Per-pixel comparison of two images, done on the 8-bit values they would
+// be written as, so a fresh render compares exactly against a saved golden
+// image. Errors are in levels (0-255) per component.
+struct ImageDiff {
+    bool same_size = false;
+    long long differing_pixels = 0;
+    int max_error = 0;       // largest component difference
+    double mean_error = 0;   // mean component difference over the image
+    // Bounding box of the pixels differing by more than the tolerance,
+    // inclusive; empty (min_x > max_x) when there are none
+    int min_x = 0;
+    int min_y = 0;
+    int max_x = -1;
+    int max_y = -1;
+
+    // True when the images match within the tolerance used
+    bool identical() const { return same_size && differing_pixels == 0; }
+};
+
+// Pixels whose components all differ by at most tolerance levels are not
+// counted as differing (they still contribute to max and mean error).
+// Images of different sizes are reported with same_size false and nothing
+// else filled in.
+ImageDiff diff_canvases(const Canvas& a, const Canvas& b, int tolerance = 0);
 
 #endif // TUPLE_H
 